@@ -0,0 +1,119 @@
+#include "bench_common.h"
+#include "gallery/BinaryIndex.h"
+#include "gallery/FlatIndex.h"
+#include "gallery/ShardedIndex.h"
+#include <algorithm>
+
+// 符号位签名扫描 + f32 精排 与 usearch HNSW 在同一人脸库上的对比：单次查询耗时、recall@k、索引内存
+// 以 f32 暴力检索为基准；查询为库中特征加噪声，模拟同一人的另一张照片
+// 用法: bench_binary_prefilter [维度] [查询数] [最大人脸数] [k]
+
+int main(int argc, char const *argv[])
+{
+    size_t dimensions = argc > 1 ? std::stoul(argv[1]) : 512;
+    size_t queries = argc > 2 ? std::stoul(argv[2]) : 500;
+    size_t max_size = argc > 3 ? std::stoul(argv[3]) : 400000;
+    size_t k = argc > 4 ? std::stoul(argv[4]) : 10;
+
+    std::mt19937 rng(42);
+    std::vector<std::vector<float>> gallery;
+    for (size_t i = 0; i < max_size; ++i)
+    {
+        gallery.push_back(random_embedding(rng, dimensions));
+    }
+
+    std::printf("dim %zu, %zu queries, recall@%zu, binary kernel: %s, candidates %zu x k\n",
+                dimensions, queries, k, BinaryIndex::isa_name(), static_cast<size_t>(GALLERY_BINARY_CANDIDATES));
+    std::printf("%10s %12s %10s %10s %12s %10s %10s\n",
+                "faces", "hnsw us/q", "hnsw r@k", "hnsw MB", "binary us/q", "binary r@k", "binary MB");
+
+    metric_punned_t metric(dimensions, metric_kind_t::cos_k, scalar_kind_t::f32_k);
+    metric_punned_t exact_metric = metric;
+    ThreadPool pool;
+    for (size_t size = 25000; size <= max_size; size *= 2)
+    {
+        // 查询：从当前规模的库中抽取特征加噪声
+        std::normal_distribution<float> noise(0.f, 0.3f / std::sqrt(static_cast<float>(dimensions)));
+        std::uniform_int_distribution<size_t> pick(0, size - 1);
+        std::vector<std::vector<float>> query_set;
+        for (size_t q = 0; q < queries; ++q)
+        {
+            std::vector<float> query = gallery[pick(rng)];
+            for (float &x : query)
+            {
+                x += noise(rng);
+            }
+            query_set.push_back(std::move(query));
+        }
+
+        std::vector<std::pair<uint64_t, const float *>> entries;
+        FlatIndex flat(dimensions, metric_kind_t::cos_k);
+        BinaryIndex binary(dimensions);
+        flat.reserve(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            entries.emplace_back(i, gallery[i].data());
+            flat.add(i, gallery[i].data());
+            binary.add(i, gallery[i].data());
+        }
+        ShardedIndex hnsw(metric, index_dense_config_t(), 1, pool.size());
+        hnsw.reserve(size);
+        hnsw.build(entries, pool);
+
+        std::vector<GalleryMatch> exact(queries * k);
+        for (size_t q = 0; q < queries; ++q)
+        {
+            flat.search(query_set[q].data(), k, exact.data() + q * k);
+        }
+        auto recall = [&](size_t q, const GalleryMatch *found, size_t count)
+        {
+            size_t hits = 0;
+            for (size_t i = 0; i < k; ++i)
+            {
+                for (size_t j = 0; j < count; ++j)
+                {
+                    if (found[j].id == exact[q * k + i].id)
+                    {
+                        ++hits;
+                        break;
+                    }
+                }
+            }
+            return hits;
+        };
+
+        std::vector<GalleryMatch> found(k * GALLERY_BINARY_CANDIDATES);
+        size_t hnsw_hits = 0;
+        BenchTimer hnsw_timer;
+        for (size_t q = 0; q < queries; ++q)
+        {
+            size_t count = hnsw.search(query_set[q].data(), k, found.data());
+            hnsw_hits += recall(q, found.data(), count);
+        }
+        double hnsw_us = hnsw_timer.elapsed_ms() * 1000.0 / queries;
+
+        // 签名扫描取候选，再按 f32 余弦距离精排取前 k 个
+        size_t binary_hits = 0;
+        BenchTimer binary_timer;
+        for (size_t q = 0; q < queries; ++q)
+        {
+            const byte_t *query = reinterpret_cast<const byte_t *>(query_set[q].data());
+            size_t count = binary.search(query_set[q].data(), found.size(), found.data());
+            for (size_t i = 0; i < count; ++i)
+            {
+                found[i].distance = static_cast<float>(exact_metric(query, reinterpret_cast<const byte_t *>(gallery[found[i].id].data())));
+            }
+            size_t top = std::min(k, count);
+            std::partial_sort(found.begin(), found.begin() + top, found.begin() + count,
+                              [](const GalleryMatch &a, const GalleryMatch &b)
+                              { return a.distance < b.distance; });
+            binary_hits += recall(q, found.data(), top);
+        }
+        double binary_us = binary_timer.elapsed_ms() * 1000.0 / queries;
+
+        std::printf("%10zu %12.2f %10.3f %10.1f %12.2f %10.3f %10.1f\n", size,
+                    hnsw_us, double(hnsw_hits) / (queries * k), hnsw.memory_usage() / 1048576.0,
+                    binary_us, double(binary_hits) / (queries * k), binary.memory_usage() / 1048576.0);
+    }
+    return 0;
+}
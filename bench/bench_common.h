@@ -0,0 +1,82 @@
+#pragma once
+#include <sqlite3.h>
+#include "common.h"
+#include "database/EmbeddingBlob.h"
+#include "database/FaceDatabase.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+// 基准测试公用工具：生成合成人脸库、计时
+
+// 生成一个单位长度的随机特征向量
+inline std::vector<float> random_embedding(std::mt19937 &rng, size_t dimensions)
+{
+    std::normal_distribution<float> dist;
+    std::vector<float> embedding(dimensions);
+    float norm = 0.f;
+    for (float &x : embedding)
+    {
+        x = dist(rng);
+        norm += x * x;
+    }
+    norm = std::sqrt(norm);
+    for (float &x : embedding)
+    {
+        x /= norm;
+    }
+    return embedding;
+}
+
+// 新建一个含 count 张随机人脸的数据库（会删除已有文件），特征按 dtype 编码
+inline std::unique_ptr<FaceDatabase> make_synthetic_database(const std::string &db_path, size_t count, size_t dimensions, uint32_t seed = 42,
+                                                             EmbeddingBlob::Dtype dtype = EmbeddingBlob::default_dtype())
+{
+    std::remove(db_path.c_str());
+    std::unique_ptr<FaceDatabase> db = FaceDatabase::create(db_path, INSPIREFACE);
+    std::mt19937 rng(seed);
+
+    sqlite3 *raw = nullptr;
+    sqlite3_open(db_path.c_str(), &raw);
+    sqlite3_exec(raw, "BEGIN;", nullptr, nullptr, nullptr);
+    sqlite3_stmt *stmt = nullptr;
+    std::vector<uint8_t> blob;
+    sqlite3_prepare_v2(raw, "INSERT INTO inspire_faces (user_name, img_path, face_encoding) VALUES (?,?,?);", -1, &stmt, nullptr);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string name = "person_" + std::to_string(i);
+        std::vector<float> embedding = random_embedding(rng, dimensions);
+        sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, "", -1, SQLITE_STATIC);
+        EmbeddingBlob::encode(embedding.data(), embedding.size(), dtype, blob);
+        sqlite3_bind_blob(stmt, 3, blob.data(), static_cast<int>(blob.size()), SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    // 每张人脸单独一个身份
+    sqlite3_exec(raw,
+                 "INSERT OR IGNORE INTO inspire_identities (user_name) SELECT user_name FROM inspire_faces;"
+                 "UPDATE inspire_faces SET identity_id = "
+                 "(SELECT id FROM inspire_identities WHERE inspire_identities.user_name = inspire_faces.user_name);",
+                 nullptr, nullptr, nullptr);
+    sqlite3_exec(raw, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_close(raw);
+    return db;
+}
+
+// 计时器
+class BenchTimer
+{
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,104 @@
+#include "bench_common.h"
+#include "database/SqliteFaceDatabase.h"
+#include <atomic>
+#include <thread>
+
+// 多线程查询吞吐：单连接（查询与写入共用 dbMutex_）对比只读连接池
+// 每个线程轮流执行 find_by_name / find_by_id / get_face_count；可选一个写线程持续注册，模拟查询与注册并发
+// 用法: bench_db_readers [数据库路径] [已有人脸数] [每个线程的查询次数] [维度] [是否并发写入 0/1]
+
+struct RunResult
+{
+    double lookups_per_s;
+    double inserts_per_s;
+};
+
+static RunResult run(FaceDatabase &db, size_t threads, size_t ops, size_t size, size_t dimensions, bool with_writer)
+{
+    std::atomic<bool> done{false};
+    std::atomic<size_t> inserted{0};
+    std::thread writer;
+    if (with_writer)
+    {
+        writer = std::thread([&]
+                             {
+                                 std::mt19937 rng(11);
+                                 Facedata face;
+                                 face.embedding = random_embedding(rng, dimensions);
+                                 while (!done)
+                                 {
+                                     face.name = "writer_" + std::to_string(inserted.load());
+                                     db.insert(face, "");
+                                     ++inserted;
+                                 } });
+    }
+
+    BenchTimer timer;
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        readers.emplace_back([&, t]
+                             {
+                                 std::mt19937 rng(static_cast<uint32_t>(t + 1));
+                                 std::uniform_int_distribution<size_t> pick(1, size);
+                                 for (size_t i = 0; i < ops; ++i)
+                                 {
+                                     size_t id = pick(rng);
+                                     switch (i % 3)
+                                     {
+                                     case 0:
+                                         db.find_by_name("person_" + std::to_string(id - 1));
+                                         break;
+                                     case 1:
+                                         db.find_by_id(static_cast<int>(id));
+                                         break;
+                                     default:
+                                         db.get_face_count();
+                                         break;
+                                     }
+                                 } });
+    }
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+    double ms = timer.elapsed_ms();
+    done = true;
+    if (writer.joinable())
+    {
+        writer.join();
+    }
+    return {threads * ops * 1000.0 / ms, inserted * 1000.0 / ms};
+}
+
+int main(int argc, char const *argv[])
+{
+    std::string db_path = argc > 1 ? argv[1] : "/tmp/bench_db_readers.db";
+    size_t size = argc > 2 ? std::stoul(argv[2]) : 20000;
+    size_t ops = argc > 3 ? std::stoul(argv[3]) : 3000;
+    size_t dimensions = argc > 4 ? std::stoul(argv[4]) : 512;
+    bool with_writer = argc > 5 ? std::stoi(argv[5]) != 0 : true;
+
+    make_synthetic_database(db_path, size, dimensions);
+
+    std::printf("%zu faces, %zu lookups per thread, dim %zu, %u cores, concurrent writer: %s\n", size, ops, dimensions,
+                std::thread::hardware_concurrency(), with_writer ? "yes" : "no");
+    std::printf("%8s %18s %18s %10s %18s %18s\n", "threads", "single lookups/s", "pool lookups/s", "speedup",
+                "single inserts/s", "pool inserts/s");
+    for (size_t threads : {1, 2, 4, 8})
+    {
+        RunResult single;
+        RunResult pooled;
+        {
+            InspireFaceDatabase db(db_path, 0);
+            single = run(db, threads, ops, size, dimensions, with_writer);
+        }
+        {
+            InspireFaceDatabase db(db_path, threads);
+            pooled = run(db, threads, ops, size, dimensions, with_writer);
+        }
+        std::printf("%8zu %18.0f %18.0f %9.2fx %18.0f %18.0f\n", threads, single.lookups_per_s, pooled.lookups_per_s,
+                    pooled.lookups_per_s / single.lookups_per_s, single.inserts_per_s, pooled.inserts_per_s);
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "bench_common.h"
+#include <functional>
+
+// 数据库预编译语句缓存：插入 / 查询吞吐对比
+//   每次编译：与旧实现相同，每次调用 sqlite3_prepare_v2 + sqlite3_finalize（另开一个连接执行相同 SQL）
+//   语句缓存：FaceDatabase 各方法，语句编译一次后 reset 复用
+// 用法: bench_db_statements [数据库路径] [已有人脸数] [每项操作次数] [维度]
+
+// 旧实现的单条语句执行方式
+static void run_uncached(sqlite3 *db, const char *sql, const std::function<void(sqlite3_stmt *)> &bind)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        return;
+    }
+    bind(stmt);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+    }
+    sqlite3_finalize(stmt);
+}
+
+int main(int argc, char const *argv[])
+{
+    std::string db_path = argc > 1 ? argv[1] : "/tmp/bench_db_statements.db";
+    size_t size = argc > 2 ? std::stoul(argv[2]) : 10000;
+    size_t ops = argc > 3 ? std::stoul(argv[3]) : 2000;
+    size_t dimensions = argc > 4 ? std::stoul(argv[4]) : 512;
+
+    std::unique_ptr<FaceDatabase> db = make_synthetic_database(db_path, size, dimensions);
+    sqlite3 *raw = nullptr;
+    sqlite3_open(db_path.c_str(), &raw);
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick(1, static_cast<int>(size));
+    std::vector<float> embedding = random_embedding(rng, dimensions);
+
+    std::printf("%zu faces, %zu ops per row, dim %zu\n", size, ops, dimensions);
+    std::printf("%-16s %14s %14s %10s\n", "operation", "prepare ops/s", "cached ops/s", "speedup");
+    auto report = [&](const char *name, const std::function<void(size_t)> &uncached, const std::function<void(size_t)> &cached)
+    {
+        BenchTimer uncached_timer;
+        for (size_t i = 0; i < ops; ++i)
+        {
+            uncached(i);
+        }
+        double uncached_ms = uncached_timer.elapsed_ms();
+        BenchTimer cached_timer;
+        for (size_t i = 0; i < ops; ++i)
+        {
+            cached(i);
+        }
+        double cached_ms = cached_timer.elapsed_ms();
+        std::printf("%-16s %14.0f %14.0f %9.2fx\n", name, ops * 1000.0 / uncached_ms, ops * 1000.0 / cached_ms, uncached_ms / cached_ms);
+    };
+
+    report("get_face_count", [&](size_t)
+           { run_uncached(raw, "SELECT COUNT(*) FROM inspire_faces;", [](sqlite3_stmt *) {}); },
+           [&](size_t)
+           { db->get_face_count(); });
+
+    report("find_by_id", [&](size_t)
+           {
+               int id = pick(rng);
+               run_uncached(raw, "SELECT id, user_name, img_path, face_encoding, identity_id FROM inspire_faces WHERE id = ?;",
+                            [id](sqlite3_stmt *stmt)
+                            { sqlite3_bind_int(stmt, 1, id); }); },
+           [&](size_t)
+           { db->find_by_id(pick(rng)); });
+
+    report("get_meta", [&](size_t)
+           { run_uncached(raw, "SELECT value FROM face_meta WHERE key = ?;", [](sqlite3_stmt *stmt)
+                          { sqlite3_bind_text(stmt, 1, "inspire_faces.dimensions", -1, SQLITE_STATIC); }); },
+           [&](size_t)
+           { db->get_meta("dimensions"); });
+
+    // 插入：身份 upsert + 查身份 id + 插入人脸，各自一个事务
+    report("insert", [&](size_t i)
+           {
+               std::string name = "uncached_" + std::to_string(i);
+               auto bind_name = [&](sqlite3_stmt *stmt)
+               { sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC); };
+               run_uncached(raw, "INSERT OR IGNORE INTO inspire_identities (user_name) VALUES (?);", bind_name);
+               run_uncached(raw, "SELECT id FROM inspire_identities WHERE user_name = ?;", bind_name);
+               run_uncached(raw, "INSERT INTO inspire_faces (user_name, img_path ,face_encoding, identity_id) VALUES (?,?,?,?);",
+                            [&](sqlite3_stmt *stmt)
+                            {
+                                bind_name(stmt);
+                                sqlite3_bind_text(stmt, 2, "", -1, SQLITE_STATIC);
+                                sqlite3_bind_blob(stmt, 3, embedding.data(), static_cast<int>(embedding.size() * sizeof(float)), SQLITE_STATIC);
+                                sqlite3_bind_int64(stmt, 4, 0);
+                            }); },
+           [&](size_t i)
+           {
+               Facedata face;
+               face.name = "cached_" + std::to_string(i);
+               face.embedding = embedding;
+               db->insert(face, "");
+           });
+
+    sqlite3_close(raw);
+    return 0;
+}
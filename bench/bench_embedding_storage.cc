@@ -0,0 +1,69 @@
+#include "bench_common.h"
+#include <algorithm>
+#include <sys/stat.h>
+
+// 特征 BLOB 的存储格式对比（f32 / f16）：数据库文件大小、load_arena 加载耗时、f16 展开后的精度
+// 精度以余弦距离误差衡量：解码特征与原始特征的 1 - cos
+// 用法: bench_embedding_storage [数据库路径] [人脸数] [维度]
+
+static size_t file_size(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::string db_path = argc > 1 ? argv[1] : "/tmp/bench_embedding_storage.db";
+    size_t size = argc > 2 ? std::stoul(argv[2]) : 100000;
+    size_t dimensions = argc > 3 ? std::stoul(argv[3]) : 512;
+
+    std::printf("%zu faces, dim %zu, f16 widen kernel: %s\n", size, dimensions, EmbeddingBlob::isa_name());
+    std::printf("%6s %12s %14s %14s %16s\n", "dtype", "db MB", "load_arena ms", "faces/s", "max 1-cos");
+
+    const std::pair<const char *, EmbeddingBlob::Dtype> formats[] = {
+        {"f32", EmbeddingBlob::Dtype::f32},
+        {"f16", EmbeddingBlob::Dtype::f16},
+    };
+    for (const auto &[name, dtype] : formats)
+    {
+        std::unique_ptr<FaceDatabase> db = make_synthetic_database(db_path, size, dimensions, 42, dtype);
+
+        // 合并 WAL 后再统计文件大小
+        sqlite3 *raw = nullptr;
+        sqlite3_open(db_path.c_str(), &raw);
+        sqlite3_exec(raw, "PRAGMA wal_checkpoint(TRUNCATE);", nullptr, nullptr, nullptr);
+        sqlite3_close(raw);
+        size_t bytes = file_size(db_path) + file_size(db_path + "-wal");
+
+        // 先加载一次预热页缓存，只比较解析与展开的开销
+        {
+            FaceArena warmup;
+            db->load_arena(warmup);
+        }
+        FaceArena arena;
+        BenchTimer timer;
+        db->load_arena(arena);
+        double ms = timer.elapsed_ms();
+
+        // 按同一种子重新生成原始特征，对比解码结果
+        std::mt19937 rng(42);
+        double max_error = 0.0;
+        for (size_t row = 0; row < arena.size(); ++row)
+        {
+            std::vector<float> original = random_embedding(rng, dimensions);
+            const float *decoded = arena.embedding(row);
+            double dot = 0.0, norm_a = 0.0, norm_b = 0.0;
+            for (size_t d = 0; d < dimensions; ++d)
+            {
+                dot += static_cast<double>(original[d]) * decoded[d];
+                norm_a += static_cast<double>(original[d]) * original[d];
+                norm_b += static_cast<double>(decoded[d]) * decoded[d];
+            }
+            max_error = std::max(max_error, 1.0 - dot / std::sqrt(norm_a * norm_b));
+        }
+
+        std::printf("%6s %12.1f %14.1f %14.0f %16.2e\n", name, bytes / 1048576.0, ms, arena.size() * 1000.0 / ms, max_error);
+    }
+    return 0;
+}
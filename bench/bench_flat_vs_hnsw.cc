@@ -0,0 +1,77 @@
+#include "bench_common.h"
+#include "gallery/FlatIndex.h"
+#include "usearch/index_dense.hpp"
+
+// 暴力检索 (FlatIndex) 与 HNSW (usearch) 的单次查询耗时对比，找出两者的交叉点
+// 结果用于设定 GALLERY_FLAT_MAX_SIZE
+// 用法: bench_flat_vs_hnsw [维度] [查询数] [最大人脸数]
+
+int main(int argc, char const *argv[])
+{
+    size_t dimensions = argc > 1 ? std::stoul(argv[1]) : 512;
+    size_t queries = argc > 2 ? std::stoul(argv[2]) : 1000;
+    size_t max_size = argc > 3 ? std::stoul(argv[3]) : 32000;
+
+    std::mt19937 rng(42);
+    std::vector<std::vector<float>> gallery;
+    for (size_t i = 0; i < max_size; ++i)
+    {
+        gallery.push_back(random_embedding(rng, dimensions));
+    }
+    std::vector<std::vector<float>> query_set;
+    for (size_t i = 0; i < queries; ++i)
+    {
+        query_set.push_back(random_embedding(rng, dimensions));
+    }
+
+    std::printf("dim %zu, %zu queries, flat kernel: %s\n", dimensions, queries, FlatIndex::isa_name());
+    std::printf("%10s %14s %14s %12s\n", "faces", "flat us/q", "hnsw us/q", "hnsw r@1");
+
+    size_t crossover = 0;
+    for (size_t size = 500; size <= max_size; size *= 2)
+    {
+        FlatIndex flat(dimensions, metric_kind_t::cos_k);
+        flat.reserve(size);
+
+        metric_punned_t metric(dimensions, metric_kind_t::cos_k, scalar_kind_t::f32_k);
+        index_dense_t hnsw = index_dense_t::make(metric);
+        hnsw.reserve(size);
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            flat.add(i, gallery[i].data());
+            hnsw.add(i, gallery[i].data());
+        }
+
+        std::vector<uint64_t> exact(queries);
+        BenchTimer flat_timer;
+        for (size_t q = 0; q < queries; ++q)
+        {
+            GalleryMatch best;
+            flat.search(query_set[q].data(), 1, &best);
+            exact[q] = best.id;
+        }
+        double flat_us = flat_timer.elapsed_ms() * 1000.0 / queries;
+
+        size_t hits = 0;
+        BenchTimer hnsw_timer;
+        for (size_t q = 0; q < queries; ++q)
+        {
+            auto result = hnsw.search(query_set[q].data(), 1);
+            hits += result.size() > 0 && result[0].member.key == exact[q];
+        }
+        double hnsw_us = hnsw_timer.elapsed_ms() * 1000.0 / queries;
+
+        if (crossover == 0 && hnsw_us < flat_us)
+        {
+            crossover = size;
+        }
+        std::printf("%10zu %14.2f %14.2f %12.3f\n", size, flat_us, hnsw_us, double(hits) / queries);
+    }
+
+    if (crossover)
+        std::printf("HNSW becomes faster at about %zu faces\n", crossover);
+    else
+        std::printf("flat scan is faster up to %zu faces\n", max_size);
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "bench_common.h"
+#include "gallery/FlatIndex.h"
+#include "gallery/ShardedIndex.h"
+#include <algorithm>
+
+// HNSW 参数 (connectivity / expansion_add / expansion_search) 的召回率与延迟
+// 以 f32 暴力检索为基准计算 recall@k，报告单次查询的 p50 / p99 延迟，用于为各现场选取 GALLERY_CONNECTIVITY 等参数
+// 查询为库中特征加少量噪声，模拟同一人的另一张照片
+// 用法: bench_index_params [face.db | synthetic] [后端 inspireface|opencv|dlib] [k] [查询数] [合成人脸数] [合成维度]
+
+static Type parse_backend(const std::string &name)
+{
+    if (name == "dlib")
+    {
+        return DLIB;
+    }
+    if (name == "opencv")
+    {
+        return OPENCV;
+    }
+    return INSPIREFACE;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::string source = argc > 1 ? argv[1] : "synthetic";
+    std::string backend = argc > 2 ? argv[2] : "inspireface";
+    size_t k = argc > 3 ? std::stoul(argv[3]) : 10;
+    size_t queries = argc > 4 ? std::stoul(argv[4]) : 1000;
+    size_t synthetic_size = argc > 5 ? std::stoul(argv[5]) : 100000;
+    size_t synthetic_dimensions = argc > 6 ? std::stoul(argv[6]) : 512;
+
+    // 人脸特征：来自数据库或随机生成
+    std::mt19937 rng(42);
+    std::vector<std::vector<float>> gallery;
+    if (source == "synthetic")
+    {
+        for (size_t i = 0; i < synthetic_size; ++i)
+        {
+            gallery.push_back(random_embedding(rng, synthetic_dimensions));
+        }
+    }
+    else
+    {
+        std::unique_ptr<FaceDatabase> db = FaceDatabase::create(source, parse_backend(backend));
+        for (Facedata &face : db->load_all_faces())
+        {
+            if (!face.embedding.empty() && (gallery.empty() || face.embedding.size() == gallery.front().size()))
+            {
+                gallery.push_back(std::move(face.embedding));
+            }
+        }
+    }
+    if (gallery.empty())
+    {
+        std::printf("no embeddings in %s\n", source.c_str());
+        return 1;
+    }
+    size_t dimensions = gallery.front().size();
+    k = std::min(k, gallery.size());
+
+    // 查询：库中特征加噪声后归一化
+    std::normal_distribution<float> noise(0.f, 0.3f / std::sqrt(static_cast<float>(dimensions)));
+    std::uniform_int_distribution<size_t> pick(0, gallery.size() - 1);
+    std::vector<std::vector<float>> query_set;
+    for (size_t q = 0; q < queries; ++q)
+    {
+        std::vector<float> query = gallery[pick(rng)];
+        float norm = 0.f;
+        for (float &x : query)
+        {
+            x += noise(rng);
+            norm += x * x;
+        }
+        norm = std::sqrt(norm);
+        for (float &x : query)
+        {
+            x /= norm;
+        }
+        query_set.push_back(std::move(query));
+    }
+
+    // 精确 top-k
+    FlatIndex flat(dimensions, metric_kind_t::cos_k);
+    flat.reserve(gallery.size());
+    std::vector<std::pair<uint64_t, const float *>> entries;
+    for (size_t i = 0; i < gallery.size(); ++i)
+    {
+        flat.add(i + 1, gallery[i].data());
+        entries.emplace_back(i + 1, gallery[i].data());
+    }
+    std::vector<GalleryMatch> exact(queries * k);
+    for (size_t q = 0; q < queries; ++q)
+    {
+        flat.search(query_set[q].data(), k, exact.data() + q * k);
+    }
+
+    std::printf("%s: %zu faces, dim %zu, %zu queries, recall@%zu\n", source.c_str(), gallery.size(), dimensions, queries, k);
+    std::printf("%6s %8s %8s %10s %10s %10s %10s\n", "M", "ef_add", "ef", "build ms", "recall", "p50 us", "p99 us");
+
+    metric_punned_t metric(dimensions, metric_kind_t::cos_k, scalar_kind_t::f32_k);
+    ThreadPool pool;
+    std::vector<GalleryMatch> found(k);
+    std::vector<double> latencies(queries);
+    for (size_t connectivity : {8, 16, 32})
+    {
+        for (size_t expansion_add : {64, 128, 256})
+        {
+            ShardedIndex index(metric, index_dense_config_t(connectivity, expansion_add, GALLERY_EXPANSION_SEARCH), 1, pool.size());
+            BenchTimer build_timer;
+            index.reserve(gallery.size());
+            index.build(entries, pool);
+            double build_ms = build_timer.elapsed_ms();
+
+            // expansion_search 不影响图结构，在同一个索引上依次测试
+            for (size_t expansion_search : {16, 32, 64, 128, 256})
+            {
+                index.change_expansion(expansion_add, expansion_search);
+                size_t hits = 0;
+                for (size_t q = 0; q < queries; ++q)
+                {
+                    BenchTimer timer;
+                    size_t count = index.search(query_set[q].data(), k, found.data());
+                    latencies[q] = timer.elapsed_ms() * 1000.0;
+                    for (size_t i = 0; i < k; ++i)
+                    {
+                        for (size_t j = 0; j < count; ++j)
+                        {
+                            if (found[j].id == exact[q * k + i].id)
+                            {
+                                ++hits;
+                                break;
+                            }
+                        }
+                    }
+                }
+                std::sort(latencies.begin(), latencies.end());
+                std::printf("%6zu %8zu %8zu %10.1f %10.4f %10.2f %10.2f\n", connectivity, expansion_add, expansion_search,
+                            build_ms, double(hits) / (queries * k), latencies[queries / 2],
+                            latencies[std::min(queries - 1, queries * 99 / 100)]);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "bench_common.h"
+#include "gallery/FaceGallery.h"
+#include <atomic>
+#include <new>
+#include <unordered_map>
+
+// 识别匹配路径的内存分配次数与耗时对比：
+//   旧路径：每个候选 operator[] 拷贝一份 Facedata，再重新计算一次余弦相似度
+//   新路径：直接用索引返回的距离换算相似度，按引用读取人脸信息
+// 用法: bench_match_alloc [人脸数] [查询数]
+
+static std::atomic<size_t> g_allocations{0};
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// 旧代码中 compareFeatures 的等价实现
+static double cosine(const std::vector<float> &a, const std::vector<float> &b)
+{
+    double dot = 0, na = 0, nb = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        dot += a[i] * b[i];
+        na += a[i] * a[i];
+        nb += b[i] * b[i];
+    }
+    return dot / (std::sqrt(na) * std::sqrt(nb));
+}
+
+int main(int argc, char const *argv[])
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 20000;
+    size_t queries = argc > 2 ? std::stoul(argv[2]) : 10000;
+    const size_t dimensions = 512;
+    const double threshold = 0.45;
+
+    std::string db_path = "/tmp/bench_match_alloc.db";
+    std::unique_ptr<FaceDatabase> db = make_synthetic_database(db_path, count, dimensions);
+    FaceGallery gallery(db.get(), "", dimensions, metric_kind_t::cos_k, "f32");
+    gallery.load();
+
+    // 旧路径使用的 id -> Facedata 哈希表
+    std::unordered_map<uint64_t, Facedata> facedata_map;
+    for (const Facedata &face : db->load_all_faces())
+    {
+        facedata_map[face.id] = face;
+    }
+
+    // 查询为库中人脸加上噪声，模拟同一人的另一张照片
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.f, 0.02f);
+    std::vector<std::vector<float>> query_set;
+    for (size_t i = 0; i < queries; ++i)
+    {
+        const GalleryFace *face = gallery.find(1 + rng() % count);
+        std::vector<float> query(face->embedding(), face->embedding() + dimensions);
+        for (float &x : query)
+        {
+            x += noise(rng);
+        }
+        query_set.push_back(query);
+    }
+    Facedata queryFace;
+    queryFace.embedding = query_set[0];
+
+    // 预热，让线程局部缓冲区和索引上下文就位
+    GalleryMatch warm[3];
+    gallery.search(query_set[0].data(), 3, warm);
+
+    // ---- 旧路径 ----
+    size_t matched_old = 0;
+    size_t allocations_before = g_allocations.load();
+    BenchTimer old_timer;
+    for (const std::vector<float> &query : query_set)
+    {
+        std::vector<GalleryMatch> results = gallery.search(query.data(), 3);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            Facedata match = facedata_map[results[i].id];
+            double similarity = cosine(query, match.embedding);
+            if (similarity >= threshold)
+            {
+                ++matched_old;
+            }
+        }
+    }
+    double old_ms = old_timer.elapsed_ms();
+    size_t old_allocations = g_allocations.load() - allocations_before;
+
+    // ---- 新路径 ----
+    RcuReadGuard guard = gallery.pin(); // find() 返回的指针在固定的版本内有效
+    size_t matched_new = 0;
+    allocations_before = g_allocations.load();
+    BenchTimer new_timer;
+    for (const std::vector<float> &query : query_set)
+    {
+        GalleryMatch best;
+        if (gallery.search(query.data(), 1, &best) == 0)
+        {
+            continue;
+        }
+        double similarity = 1.0 - best.distance;
+        const GalleryFace *match = gallery.find(best.id);
+        if (match != nullptr && similarity >= threshold)
+        {
+            ++matched_new;
+        }
+    }
+    double new_ms = new_timer.elapsed_ms();
+    size_t new_allocations = g_allocations.load() - allocations_before;
+
+    std::printf("gallery %zu faces, %zu queries, dim %zu\n", count, queries, dimensions);
+    std::printf("%-8s %14s %14s %10s\n", "path", "allocs/query", "us/query", "matched");
+    std::printf("%-8s %14.2f %14.2f %10zu\n", "old", double(old_allocations) / queries, old_ms * 1000.0 / queries, matched_old);
+    std::printf("%-8s %14.2f %14.2f %10zu\n", "new", double(new_allocations) / queries, new_ms * 1000.0 / queries, matched_new);
+
+    std::remove(db_path.c_str());
+    return 0;
+}
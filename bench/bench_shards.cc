@@ -0,0 +1,84 @@
+#include "bench_common.h"
+#include "gallery/FlatIndex.h"
+#include "gallery/ShardedIndex.h"
+#include <algorithm>
+#include <thread>
+
+// 分片索引：建索引耗时、单次查询延迟 (平均 / p99) 随分片数的变化
+// 分片数从 1 开始翻倍直到 CPU 核数，结果用于设定 GALLERY_SHARDS / GALLERY_SHARD_MIN_SIZE
+// 用法: bench_shards [维度] [人脸数] [查询数] [最大分片数]
+
+int main(int argc, char const *argv[])
+{
+    size_t dimensions = argc > 1 ? std::stoul(argv[1]) : 512;
+    size_t size = argc > 2 ? std::stoul(argv[2]) : 200000;
+    size_t queries = argc > 3 ? std::stoul(argv[3]) : 1000;
+    size_t max_shards = argc > 4 ? std::stoul(argv[4]) : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+    std::mt19937 rng(42);
+    std::vector<std::vector<float>> gallery;
+    std::vector<std::pair<uint64_t, const float *>> entries;
+    for (size_t i = 0; i < size; ++i)
+    {
+        gallery.push_back(random_embedding(rng, dimensions));
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        entries.emplace_back(i + 1, gallery[i].data());
+    }
+    std::vector<std::vector<float>> query_set;
+    for (size_t i = 0; i < queries; ++i)
+    {
+        query_set.push_back(random_embedding(rng, dimensions));
+    }
+
+    // 精确结果作为 recall 的基准
+    FlatIndex flat(dimensions, metric_kind_t::cos_k);
+    flat.reserve(size);
+    for (const auto &[key, vector] : entries)
+    {
+        flat.add(key, vector);
+    }
+    std::vector<uint64_t> exact(queries);
+    for (size_t q = 0; q < queries; ++q)
+    {
+        GalleryMatch best;
+        flat.search(query_set[q].data(), 1, &best);
+        exact[q] = best.id;
+    }
+
+    std::printf("dim %zu, %zu faces, %zu queries, %u cores\n", dimensions, size, queries, std::thread::hardware_concurrency());
+    std::printf("%8s %12s %12s %12s %10s\n", "shards", "build ms", "avg us/q", "p99 us/q", "r@1");
+
+    metric_punned_t metric(dimensions, metric_kind_t::cos_k, scalar_kind_t::f32_k);
+    ThreadPool pool;
+    for (size_t shards = 1; shards <= max_shards; shards *= 2)
+    {
+        ShardedIndex index(metric, index_dense_config_t(), shards, pool.size());
+        BenchTimer build_timer;
+        index.reserve(size / shards + size / (shards * 8) + 1);
+        index.build(entries, pool);
+        double build_ms = build_timer.elapsed_ms();
+
+        std::vector<double> latencies(queries);
+        size_t hits = 0;
+        for (size_t q = 0; q < queries; ++q)
+        {
+            GalleryMatch best;
+            BenchTimer timer;
+            size_t found = index.search(query_set[q].data(), 1, &best);
+            latencies[q] = timer.elapsed_ms() * 1000.0;
+            hits += found > 0 && best.id == exact[q];
+        }
+
+        double total_us = 0;
+        for (double us : latencies)
+        {
+            total_us += us;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        double p99 = latencies[std::min(queries - 1, queries * 99 / 100)];
+        std::printf("%8zu %12.1f %12.2f %12.2f %10.3f\n", shards, build_ms, total_us / queries, p99, double(hits) / queries);
+    }
+    return 0;
+}
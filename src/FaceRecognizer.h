@@ -36,6 +36,13 @@ public:
      */
     virtual bool registerFace(const std::string path, const std::string &name) = 0;
 
+    /**
+     * @brief 批量注册：并行读取图片、提取特征，按事务分批写入数据库，最后一次性加入人脸库
+     * @param batch 待注册的图片与姓名
+     * @return 与 batch 一一对应的人脸 id，注册失败的为 -1
+     */
+    virtual std::vector<int64_t> registerFaces(const std::vector<FaceEnrollment> &batch) = 0;
+
     /**
      * @brief 在人脸库中查找人脸特征
      * @param faceImage 人脸图片
@@ -43,11 +50,19 @@ public:
      */
     virtual std::vector<Facedata> recognizeFace(const cv::Mat &faceImage) = 0;
 
+    /**
+     * @brief 在人脸库中查找人脸特征，每张人脸返回最相近的 k 个身份
+     * @param faceImage 人脸图片
+     * @param k 每张人脸的候选数
+     * @return 每张检测到的人脸一项，候选按相似度降序，未达阈值的候选也会返回
+     */
+    virtual std::vector<FaceRecognition> recognizeTopK(const cv::Mat &faceImage, size_t k) = 0;
+
     // 根据name查找数据库人脸数据
     /**
      * @brief 根据name查找数据库人脸数据
      * @param name 人脸名称
-     * @return 匹配到的人脸结构体列表
+     * @return 匹配到的人脸结构体列表；有注册尚未写入数据库时返回空
      */
     virtual std::vector<Facedata> findByNname(const std::string &name) = 0;
 
@@ -61,13 +76,13 @@ public:
     /**
      * @brief 删除人脸操作
      * @param name 人脸名称
-     * @return 删除成功返回 true，失败返回 false
+     * @return 删除成功返回 true，失败（包括有注册尚未写入数据库）返回 false
      */
     virtual bool deleteFaceByName(const std::string &name) = 0;
 
     /**
      * @brief 查看人脸库人脸数量
-     * @return 人脸数量
+     * @return 人脸数量，失败（包括有注册尚未写入数据库）返回 -1
      */
     virtual int getFacedatabaseCount() = 0;
 
@@ -78,6 +93,15 @@ public:
      */
     virtual bool setThreshold(double threshold) = 0;
 
+    /**
+     * @brief 设置人脸库 HNSW 索引参数
+     * @param connectivity 每个节点的邻居数，修改后在后台重建索引
+     * @param expansion_add 建索引时的候选队列长度，修改后在后台重建索引
+     * @param expansion_search 检索时的候选队列长度，立即生效
+     * @return 成功返回 true，失败返回 false
+     */
+    virtual bool setIndexParams(size_t connectivity, size_t expansion_add, size_t expansion_search) = 0;
+
     // 获取当前使用的后端名称（用于日志/调试）
     /**
      * @brief 获取当前使用的后端名称
@@ -16,6 +16,22 @@
 
 // -------------------------人脸库路径-----------------------------------------
 #define DATABASE_PATH "/home/fitz/projects/face/opencv_face_recognition/data/database/face.db"
+// 索引快照与 face.db 放在同一目录，文件名为 face.db.<后端>.usearch
+#define GALLERY_SNAPSHOT_SUFFIX ".usearch"
+// 数据库以 WAL 模式打开，同步级别 OFF / NORMAL / FULL；WAL 下 NORMAL 断电只会丢失最近提交的事务，不会损坏数据库
+#define DATABASE_SYNCHRONOUS "NORMAL"
+// 批量注册时每个事务写入的行数
+#define DATABASE_BATCH_ROWS 1000
+// 新写入特征的存储格式: "f16" 半精度（BLOB 减半），"f32" 单精度；旧版本写入的裸 f32 数据照常读取
+#define DATABASE_EMBEDDING_DTYPE "f16"
+// 注册写后日志，与数据库同目录，名为 face.db.<后端>.journal
+#define DATABASE_JOURNAL_SUFFIX ".journal"
+// 写后日志每次从数据库预留的人脸 id 数（身份 id 同），用掉一块时后台线程预留下一块
+#define DATABASE_JOURNAL_ID_BLOCK 64
+// 写后日志写入数据库失败后重试的间隔（毫秒）
+#define DATABASE_JOURNAL_RETRY_MS 1000
+// 每个后端的只读连接数，按姓名/id 查询和启动加载使用只读连接，与写入及彼此并发（WAL）；0 表示查询也使用写连接
+#define DATABASE_READ_CONNECTIONS 4
 
 // ------------------------------------------------------------------
 // 人脸识别模式枚举
@@ -30,12 +46,37 @@ typedef enum
 typedef struct Facedata
 {
     int id = -1;
+    int identity_id = -1;         // 身份 id，同一人的多张模板共用
     int x, y, width, height;      // 人脸框 (x, y, w, h)
     float score = 0.0f;           // 检测分数
     std::vector<float> embedding; // 128维或512维特征向量
     std::string name;             // 识别出的姓名
 } Facedata;
 
+// 批量注册的一项
+typedef struct FaceEnrollment
+{
+    std::string name; // 姓名，同名即同一身份
+    std::string path; // 图片路径，图片中须恰好一张人脸
+} FaceEnrollment;
+
+// 识别候选
+typedef struct FaceCandidate
+{
+    int id = -1;             // 命中的模板（人脸 id）
+    int identity_id = -1;    // 身份 id
+    std::string name;        // 姓名
+    float similarity = 0.0f; // 相似度，越大越像：余弦度量为余弦相似度，Dlib 为 1 - 欧氏距离
+    bool accepted = false;   // 是否达到识别阈值
+} FaceCandidate;
+
+// 一张人脸的 top-k 识别结果
+typedef struct FaceRecognition
+{
+    Facedata face;                         // 检测到的人脸，最佳候选达到阈值时填入其姓名，否则为 "unknown"
+    std::vector<FaceCandidate> candidates; // 按身份合并后的候选，按相似度降序
+} FaceRecognition;
+
 // 
 typedef struct FaceStateInfo
 {
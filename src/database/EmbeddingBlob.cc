@@ -0,0 +1,223 @@
+#include "EmbeddingBlob.h"
+#include "fp16/fp16.h"
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr uint8_t kMagic[4] = {'F', 'E', 0xFF, 0x7F};
+    constexpr uint8_t kVersion = 1;
+    constexpr size_t kHeaderSize = 16;
+
+    struct Header
+    {
+        uint8_t version;
+        EmbeddingBlob::Dtype dtype;
+        uint32_t dimensions;
+        float norm;
+    };
+
+    // 解析头并核对长度；没有头时按旧的裸 f32 数组处理
+    bool parse(const void *blob, size_t bytes, Header &header)
+    {
+        const uint8_t *data = static_cast<const uint8_t *>(blob);
+        if (data == nullptr || bytes == 0)
+        {
+            return false;
+        }
+        if (bytes < kHeaderSize || memcmp(data, kMagic, sizeof(kMagic)) != 0)
+        {
+            if (bytes % sizeof(float) != 0)
+            {
+                return false;
+            }
+            header = {0, EmbeddingBlob::Dtype::f32, static_cast<uint32_t>(bytes / sizeof(float)), 1.f};
+            return true;
+        }
+
+        header.version = data[4];
+        header.dtype = static_cast<EmbeddingBlob::Dtype>(data[5]);
+        memcpy(&header.dimensions, data + 8, sizeof(uint32_t));
+        memcpy(&header.norm, data + 12, sizeof(float));
+        if (header.version != kVersion)
+        {
+            return false;
+        }
+        size_t element = 0;
+        if (header.dtype == EmbeddingBlob::Dtype::f16)
+        {
+            element = sizeof(uint16_t);
+        }
+        else if (header.dtype == EmbeddingBlob::Dtype::f32)
+        {
+            element = sizeof(float);
+        }
+        return element != 0 && header.dimensions > 0 && bytes == kHeaderSize + header.dimensions * element;
+    }
+
+    // f16 展开为 f32 并乘以 scale
+    using widen_fn = void (*)(const uint16_t *in, size_t count, float scale, float *out);
+
+    void widen_scalar(const uint16_t *in, size_t count, float scale, float *out)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint16_t h;
+            memcpy(&h, in + i, sizeof(h));
+            out[i] = fp16_ieee_to_fp32_value(h) * scale;
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx,f16c"))) void widen_f16c(const uint16_t *in, size_t count, float scale, float *out)
+    {
+        __m256 s = _mm256_set1_ps(scale);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtph_ps(h), s));
+        }
+        widen_scalar(in + i, count - i, scale, out + i);
+    }
+
+    __attribute__((target("avx512f"))) void widen_avx512(const uint16_t *in, size_t count, float scale, float *out)
+    {
+        __m512 s = _mm512_set1_ps(scale);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_cvtph_ps(h), s));
+        }
+        widen_scalar(in + i, count - i, scale, out + i);
+    }
+#endif
+
+    // 按 CPU 特性选择实现，只在第一次使用时检测
+    struct WidenKernel
+    {
+        widen_fn fn = widen_scalar;
+        const char *name = "scalar";
+
+        WidenKernel()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+            {
+                fn = widen_avx512;
+                name = "avx512";
+            }
+            else if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c"))
+            {
+                fn = widen_f16c;
+                name = "f16c";
+            }
+#endif
+        }
+    };
+
+    const WidenKernel &kernel()
+    {
+        static const WidenKernel instance;
+        return instance;
+    }
+
+}
+
+EmbeddingBlob::Dtype EmbeddingBlob::default_dtype()
+{
+    static const Dtype dtype = dtype_from_name(DATABASE_EMBEDDING_DTYPE);
+    return dtype;
+}
+
+EmbeddingBlob::Dtype EmbeddingBlob::dtype_from_name(const char *name)
+{
+    return strcmp(name, "f16") == 0 ? Dtype::f16 : Dtype::f32;
+}
+
+void EmbeddingBlob::encode(const float *embedding, size_t dimensions, std::vector<uint8_t> &out)
+{
+    encode(embedding, dimensions, default_dtype(), out);
+}
+
+void EmbeddingBlob::encode(const float *embedding, size_t dimensions, Dtype dtype, std::vector<uint8_t> &out)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < dimensions; ++i)
+    {
+        sum += static_cast<double>(embedding[i]) * embedding[i];
+    }
+    float norm = static_cast<float>(std::sqrt(sum));
+
+    size_t element = dtype == Dtype::f16 ? sizeof(uint16_t) : sizeof(float);
+    out.resize(kHeaderSize + dimensions * element);
+    uint8_t *data = out.data();
+    uint32_t dims = static_cast<uint32_t>(dimensions);
+    memcpy(data, kMagic, sizeof(kMagic));
+    data[4] = kVersion;
+    data[5] = static_cast<uint8_t>(dtype);
+    data[6] = data[7] = 0;
+    memcpy(data + 8, &dims, sizeof(dims));
+    memcpy(data + 12, &norm, sizeof(norm));
+
+    if (dtype == Dtype::f16)
+    {
+        // 存方向，读出时乘回范数
+        float scale = norm > 0.f ? 1.f / norm : 1.f;
+        for (size_t i = 0; i < dimensions; ++i)
+        {
+            uint16_t h = fp16_ieee_from_fp32_value(embedding[i] * scale);
+            memcpy(data + kHeaderSize + i * sizeof(h), &h, sizeof(h));
+        }
+    }
+    else
+    {
+        memcpy(data + kHeaderSize, embedding, dimensions * sizeof(float));
+    }
+}
+
+size_t EmbeddingBlob::dimensions(const void *blob, size_t bytes)
+{
+    Header header;
+    return parse(blob, bytes, header) ? header.dimensions : 0;
+}
+
+bool EmbeddingBlob::decode(const void *blob, size_t bytes, float *out)
+{
+    Header header;
+    if (!parse(blob, bytes, header))
+    {
+        return false;
+    }
+    const uint8_t *payload = static_cast<const uint8_t *>(blob) + (header.version == 0 ? 0 : kHeaderSize);
+    if (header.dtype == Dtype::f16)
+    {
+        kernel().fn(reinterpret_cast<const uint16_t *>(payload), header.dimensions,
+                    header.norm > 0.f ? header.norm : 1.f, out);
+    }
+    else
+    {
+        memcpy(out, payload, header.dimensions * sizeof(float));
+    }
+    return true;
+}
+
+bool EmbeddingBlob::decode(const void *blob, size_t bytes, std::vector<float> &out)
+{
+    size_t dims = dimensions(blob, bytes);
+    if (dims == 0)
+    {
+        return false;
+    }
+    out.resize(dims);
+    return decode(blob, bytes, out.data());
+}
+
+const char *EmbeddingBlob::isa_name()
+{
+    return kernel().name;
+}
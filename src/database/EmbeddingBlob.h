@@ -0,0 +1,38 @@
+#pragma once
+#include "common.h"
+
+// 人脸特征在数据库 BLOB 列中的编码
+// 带 16 字节头：魔数(4) 版本(1) 数据类型(1) 保留(2) 维度(u32) 范数(f32)，之后是 维度 x 元素
+// f16 存单位化后的方向，读出时乘回范数，未归一化的特征也不会溢出半精度范围
+// 没有头的 BLOB 是旧版本写入的裸 f32 数组，照常读取；魔数按 f32 解释是 NaN，不会与旧数据混淆
+class EmbeddingBlob
+{
+public:
+    enum class Dtype : uint8_t
+    {
+        f32 = 0,
+        f16 = 1,
+    };
+
+    // DATABASE_EMBEDDING_DTYPE 对应的数据类型
+    static Dtype default_dtype();
+
+    // 按名称（"f16" / "f32"）取数据类型，其他名称按 f32
+    static Dtype dtype_from_name(const char *name);
+
+    // 按 DATABASE_EMBEDDING_DTYPE 编码到 out
+    static void encode(const float *embedding, size_t dimensions, std::vector<uint8_t> &out);
+    static void encode(const float *embedding, size_t dimensions, Dtype dtype, std::vector<uint8_t> &out);
+
+    // BLOB 中特征的维度，格式无法识别时返回 0
+    static size_t dimensions(const void *blob, size_t bytes);
+
+    // 解码到 out[0, dimensions)，格式无法识别时返回 false
+    static bool decode(const void *blob, size_t bytes, float *out);
+
+    // 解码到 vector，按维度调整大小
+    static bool decode(const void *blob, size_t bytes, std::vector<float> &out);
+
+    // 运行时选中的 f16 转换实现（avx512 / f16c / scalar）
+    static const char *isa_name();
+};
@@ -0,0 +1,116 @@
+#include "FaceArena.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr size_t kAlignment = 64;
+}
+
+void FaceArena::reserve(size_t rows, size_t dimensions)
+{
+    this->ids_.reserve(rows);
+    this->identity_ids_.reserve(rows);
+    this->name_offsets_.reserve(rows + 1);
+    this->reserved_ = std::max(this->reserved_, rows);
+    if (this->dimensions_ == 0 && dimensions > 0)
+    {
+        this->dimensions_ = dimensions;
+    }
+    if (this->dimensions_ > 0)
+    {
+        this->grow(rows);
+    }
+}
+
+bool FaceArena::grow(size_t rows)
+{
+    if (rows <= this->capacity_)
+    {
+        return true;
+    }
+    // aligned_alloc 要求大小是对齐的整数倍
+    size_t bytes = (rows * this->dimensions_ * sizeof(float) + kAlignment - 1) / kAlignment * kAlignment;
+    float *memory = static_cast<float *>(std::aligned_alloc(kAlignment, bytes));
+    if (memory == nullptr)
+    {
+        LOGE("特征区分配失败: " << bytes << " bytes");
+        return false;
+    }
+    if (this->embeddings_)
+    {
+        std::memcpy(memory, this->embeddings_.get(), this->size() * this->dimensions_ * sizeof(float));
+    }
+    this->embeddings_.reset(memory);
+    this->capacity_ = rows;
+    return true;
+}
+
+bool FaceArena::append(int id, int identity_id, std::string_view name, const float *embedding, size_t dimensions)
+{
+    float *row = this->append_row(id, identity_id, name, dimensions);
+    if (row == nullptr)
+    {
+        return false;
+    }
+    std::memcpy(row, embedding, dimensions * sizeof(float));
+    return true;
+}
+
+float *FaceArena::append_row(int id, int identity_id, std::string_view name, size_t dimensions)
+{
+    if (this->dimensions_ == 0)
+    {
+        this->dimensions_ = dimensions;
+    }
+    if (dimensions != this->dimensions_ || dimensions == 0)
+    {
+        LOGW("跳过维度不一致的人脸, id: " << id << ", dim: " << dimensions);
+        return nullptr;
+    }
+    if (!this->ids_.empty() && id <= this->ids_.back())
+    {
+        LOGW("跳过乱序的人脸, id: " << id);
+        return nullptr;
+    }
+    size_t row = this->size();
+    if (row == this->capacity_ && !this->grow(std::max({this->reserved_, this->capacity_ * 2, size_t(1024)})))
+    {
+        return nullptr;
+    }
+
+    this->ids_.push_back(id);
+    this->identity_ids_.push_back(identity_id);
+    if (this->name_offsets_.empty())
+    {
+        this->name_offsets_.push_back(0);
+    }
+    this->names_.append(name);
+    this->name_offsets_.push_back(static_cast<uint32_t>(this->names_.size()));
+    return this->embeddings_.get() + row * this->dimensions_;
+}
+
+std::string_view FaceArena::name(size_t row) const
+{
+    return std::string_view(this->names_).substr(this->name_offsets_[row], this->name_offsets_[row + 1] - this->name_offsets_[row]);
+}
+
+const float *FaceArena::find(uint64_t id) const
+{
+    auto it = std::lower_bound(this->ids_.begin(), this->ids_.end(), static_cast<int64_t>(id),
+                               [](int a, int64_t b)
+                               { return a < b; });
+    if (it == this->ids_.end() || *it != static_cast<int64_t>(id))
+    {
+        return nullptr;
+    }
+    return this->embedding(static_cast<size_t>(it - this->ids_.begin()));
+}
+
+size_t FaceArena::memory_usage() const
+{
+    return this->capacity_ * this->dimensions_ * sizeof(float) +
+           this->ids_.capacity() * sizeof(int) * 2 +
+           this->name_offsets_.capacity() * sizeof(uint32_t) +
+           this->names_.capacity();
+}
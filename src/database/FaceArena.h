@@ -0,0 +1,56 @@
+#pragma once
+#include "common.h"
+#include <cstdlib>
+#include <string_view>
+
+// 批量加载的人脸数据：全部特征按行连续存放在一块 64 字节对齐的内存中，
+// id / 身份 / 姓名存放在紧凑的表中（姓名共用一个字符串池），不为每张人脸单独分配内存
+// 行按 id 升序追加，按 id 查找用二分
+class FaceArena
+{
+public:
+    FaceArena() = default;
+    FaceArena(const FaceArena &) = delete;
+    FaceArena &operator=(const FaceArena &) = delete;
+
+    // 预留 rows 行，dimensions 为 0 时等第一行确定维度后再分配特征区
+    void reserve(size_t rows, size_t dimensions = 0);
+
+    // 追加一行，第一行确定维度；维度不一致或 id 不递增时跳过并返回 false
+    bool append(int id, int identity_id, std::string_view name, const float *embedding, size_t dimensions);
+
+    // 同上，但不复制特征：返回新行的特征区由调用方写入（例如直接解码到位），跳过时返回 nullptr
+    float *append_row(int id, int identity_id, std::string_view name, size_t dimensions);
+
+    size_t size() const { return this->ids_.size(); }
+    size_t dimensions() const { return this->dimensions_; }
+
+    int id(size_t row) const { return this->ids_[row]; }
+    int identity_id(size_t row) const { return this->identity_ids_[row]; }
+    std::string_view name(size_t row) const;
+    const float *embedding(size_t row) const { return this->embeddings_.get() + row * this->dimensions_; }
+
+    // 按人脸 id 查找特征，不存在返回 nullptr
+    const float *find(uint64_t id) const;
+
+    // 占用的内存（字节）
+    size_t memory_usage() const;
+
+private:
+    struct FreeDeleter
+    {
+        void operator()(float *ptr) const { std::free(ptr); }
+    };
+
+    // 特征区扩容到 rows 行
+    bool grow(size_t rows);
+
+    size_t dimensions_ = 0;
+    size_t capacity_ = 0; // 特征区可容纳的行数
+    size_t reserved_ = 0; // 维度确定前预留的行数
+    std::unique_ptr<float[], FreeDeleter> embeddings_;
+    std::vector<int> ids_;
+    std::vector<int> identity_ids_;
+    std::vector<uint32_t> name_offsets_; // 第 i 行姓名为 names_[name_offsets_[i], name_offsets_[i + 1])
+    std::string names_;
+};
@@ -1,9 +1,7 @@
 #include "FaceDatabase.h" 
-#include "OpencvFaceDatabase.h"
-#include "DlibFaceDatabase.h"
-#include "InspireFaceDatabase.h"
+#include "SqliteFaceDatabase.h"
 
-// 工厂模式
+// 工厂模式：三个后端是同一个实现，只是表名不同
 std::unique_ptr<FaceDatabase> FaceDatabase::create(const std::string& db_path,Type type)
 {
     std::unique_ptr<FaceDatabase> facedatabase;
@@ -1,38 +1,77 @@
 #pragma once
-#include <sqlite3.h>
 #include "common.h"
+#include "FaceArena.h"
 
 class FaceDatabase {
 public:
     // 工厂方法
     static std::unique_ptr<FaceDatabase> create(const std::string& db_path,Type type);
 
+    // 通过基类指针释放时关闭连接
+    virtual ~FaceDatabase() = default;
+
     // 初始化表结构
     virtual bool init_table() = 0;
 
     // 插入操作
     virtual int64_t insert(const Facedata& face, const std::string& img_path) = 0;
 
+    // 批量插入，每 DATABASE_BATCH_ROWS 行一个事务；写回每条的 id 与 identity_id（失败的 id 为 -1），返回成功条数
+    virtual int64_t insert_batch(std::vector<Facedata>& faces, const std::vector<std::string>& img_paths) = 0;
+
+    // 预留 count 个连续的人脸 id（写后日志先分配 id 再落盘），返回第一个，失败返回 -1；之后自增分配的 id 不会与之重复
+    virtual int64_t reserve_ids(size_t count) = 0;
+
+    // 预留 count 个连续的身份 id，返回第一个，失败返回 -1；之后自增分配的身份 id 不会与之重复
+    virtual int64_t reserve_identity_ids(size_t count) = 0;
+
+    // 读取全部身份 (id, 姓名)
+    virtual bool load_identities(std::vector<std::pair<int64_t, std::string>>& identities) = 0;
+
+    // 按预先分配的 id 和身份写入（写后日志使用），id 已存在的跳过；一个事务，提交时同步落盘
+    // 身份不存在时按预分配的 id 创建；姓名已有其他 id 的身份（其他连接创建）时改用已有的，写回 identity_id
+    // 返回新写入的条数，失败返回 -1
+    virtual int64_t insert_journaled(std::vector<Facedata>& faces, const std::vector<std::string>& img_paths) = 0;
+
     // 查询数据库人脸数量
     virtual int64_t get_face_count() = 0;
 
     // 根据名称查找人脸数据
     virtual std::vector<Facedata> find_by_name(const std::string& name) = 0;
 
+    // 根据名称查找全部人脸 id（走姓名索引，不读取特征）
+    virtual std::vector<int64_t> find_ids_by_name(const std::string& name) = 0;
+
     // 根据ID查找人脸数据
     virtual std::vector<Facedata> find_by_id(int id) = 0;
 
     // 获取所有已知人脸数据（用于程序启动时加载到内存）
     virtual std::vector<Facedata> load_all_faces() = 0;
 
-    // 根据名称删除人脸数据
-    virtual int64_t delete_by_name(const std::string& name) = 0;
+    // 流式加载全部人脸（只含 id、姓名、身份和特征）到连续特征区，用于启动时建立人脸库
+    virtual bool load_arena(FaceArena& arena) = 0;
+
+    // 根据名称删除该姓名的全部人脸数据，返回被删除的 id（没有或失败时为空）
+    virtual std::vector<int64_t> delete_by_name(const std::string& name) = 0;
 
     // 根据ID删除人脸数据
     virtual int64_t delete_by_id(int id) = 0;
 
-private:
-    sqlite3* db_;
-    std::string databastpath_;
-    Type type_;
+    // 当前变更序号：人脸表每插入、更新、删除一行，变更日志记一条，序号单调递增；失败返回 -1
+    virtual int64_t change_sequence() = 0;
+
+    // 序号大于 sequence 的变更涉及的人脸 id 和身份 id（各自去重）；日志不能覆盖 sequence 时返回 false
+    virtual bool changes_since(int64_t sequence, std::vector<int64_t>& face_ids, std::vector<int64_t>& identity_ids) = 0;
+
+    // 删除序号不大于 sequence 的变更（这些变更已包含在索引快照中）
+    virtual bool prune_changes(int64_t sequence) = 0;
+
+    // 数据库被其他连接（其他进程的写入，如管理工具）提交修改后变化的计数，本连接的写入不改变它；失败返回 -1
+    virtual int64_t data_version() = 0;
+
+    // 读取本后端的元数据（特征维度、度量等），不存在返回空字符串
+    virtual std::string get_meta(const std::string& key) = 0;
+
+    // 写入本后端的元数据
+    virtual bool set_meta(const std::string& key, const std::string& value) = 0;
 };
\ No newline at end of file
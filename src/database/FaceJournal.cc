@@ -0,0 +1,580 @@
+#include "FaceJournal.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    // 日志文件头：魔数 + 版本；每条记录：负载长度(u32) + 负载 CRC32(u32) + 负载
+    // 负载：id(i64) identity_id(i64) 姓名长度(u32) 姓名 路径长度(u32) 路径 维度(u32) 特征(f32 x 维度)
+    constexpr char kMagic[4] = {'F', 'J', 'N', 'L'};
+    constexpr uint32_t kVersion = 1;
+    constexpr size_t kHeaderSize = sizeof(kMagic) + sizeof(uint32_t);
+    constexpr size_t kMaxPayload = 64u << 20; // 超过视为损坏
+
+    // CRC32（IEEE 多项式），表在第一次使用时生成
+    uint32_t crc32(const char *data, size_t size)
+    {
+        static const std::vector<uint32_t> table = []
+        {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    template <typename T>
+    void put(std::string &out, const T &value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool get(const char *&in, const char *end, T &value)
+    {
+        if (static_cast<size_t>(end - in) < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return true;
+    }
+
+    bool get_string(const char *&in, const char *end, std::string &value)
+    {
+        uint32_t size = 0;
+        if (!get(in, end, size) || static_cast<size_t>(end - in) < size)
+        {
+            return false;
+        }
+        value.assign(in, size);
+        in += size;
+        return true;
+    }
+
+    // 写满 size 字节，被信号打断时继续
+    bool write_all(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    // 从数据库每次预留的 id 数
+    constexpr int64_t kIdBlock = DATABASE_JOURNAL_ID_BLOCK;
+}
+
+std::unique_ptr<FaceJournal> FaceJournal::create(FaceDatabase *database, const std::string &path)
+{
+    return std::make_unique<FaceJournal>(database, path);
+}
+
+FaceJournal::FaceJournal(FaceDatabase *database, const std::string &path)
+    : database_(database), path_(path)
+{
+    // 姓名到身份的缓存，之后 reserve() 不再按姓名查数据库
+    std::vector<std::pair<int64_t, std::string>> identities;
+    if (this->database_->load_identities(identities))
+    {
+        for (auto &identity : identities)
+        {
+            this->identities_.emplace(std::move(identity.second), identity.first);
+        }
+    }
+
+    this->fd_ = ::open(this->path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->fd_ < 0)
+    {
+        LOGE("无法打开注册日志，注册不受崩溃保护: " << this->path_ << " " << strerror(errno));
+    }
+    else
+    {
+        // 重放上次退出前没有写入数据库的记录；写入失败的留在日志中，交给后台线程重试
+        std::vector<Record> records;
+        if (this->read_records(records) && !records.empty())
+        {
+            LOGI("重放注册日志: " << records.size() << " 条记录");
+            this->apply(records);
+        }
+    }
+    this->refill_blocks();
+    this->writer_ = std::thread(&FaceJournal::run, this);
+}
+
+FaceJournal::~FaceJournal()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->stopping_ = true;
+    }
+    this->wake_.notify_all();
+    if (this->writer_.joinable())
+    {
+        this->writer_.join();
+    }
+    if (this->fd_ >= 0)
+    {
+        ::close(this->fd_);
+    }
+}
+
+bool FaceJournal::reserve(Facedata &face)
+{
+    if (face.embedding.empty())
+    {
+        LOGE("特征向量为空，拒绝注册");
+        return false;
+    }
+
+    bool refill = false;
+    {
+        std::lock_guard<std::mutex> lock(this->idMutex_);
+        auto it = this->identities_.find(face.name);
+        int64_t identity_id;
+        if (it != this->identities_.end())
+        {
+            identity_id = it->second;
+        }
+        else
+        {
+            // 新姓名：先分配身份 id 并记下，同名的后续注册归入同一身份；身份行随第一条人脸写入数据库
+            identity_id = this->take(this->identity_ids_, &FaceDatabase::reserve_identity_ids, refill);
+            if (identity_id < 0)
+            {
+                return false;
+            }
+            this->identities_.emplace(face.name, identity_id);
+        }
+        int64_t id = this->take(this->face_ids_, &FaceDatabase::reserve_ids, refill);
+        if (id < 0)
+        {
+            return false;
+        }
+        face.id = static_cast<int>(id);
+        face.identity_id = static_cast<int>(identity_id);
+
+        // 从分配起就算作未写入：调用方随后加入内存人脸库，入队前人脸库与数据库核对时不能把它当作已删除
+        std::lock_guard<std::mutex> flight(this->mutex_);
+        this->in_flight_.insert(static_cast<uint64_t>(face.id));
+        this->refill_ = this->refill_ || refill;
+    }
+    if (refill)
+    {
+        this->wake_.notify_one();
+    }
+    return true;
+}
+
+void FaceJournal::release(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->in_flight_.erase(id);
+}
+
+void FaceJournal::remember_identities(const std::vector<Facedata> &faces)
+{
+    std::lock_guard<std::mutex> lock(this->idMutex_);
+    for (const Facedata &face : faces)
+    {
+        if (face.id > 0 && face.identity_id >= 0)
+        {
+            this->identities_[face.name] = face.identity_id;
+        }
+    }
+}
+
+int64_t FaceJournal::take(IdBlock &block, int64_t (FaceDatabase::*reserve)(size_t), bool &refill)
+{
+    if (block.next >= block.end)
+    {
+        int64_t first = block.spare;
+        if (first >= 0)
+        {
+            block.spare = -1;
+        }
+        else
+        {
+            // 后台线程还没预留好下一块，只能在这里同步预留
+            LOGW("注册日志预留的 id 已用完，同步预留");
+            first = (this->database_->*reserve)(kIdBlock);
+            if (first < 0)
+            {
+                return -1;
+            }
+        }
+        block.next = first;
+        block.end = first + kIdBlock;
+        refill = true;
+    }
+    return block.next++;
+}
+
+void FaceJournal::refill_blocks()
+{
+    bool face_ids;
+    bool identity_ids;
+    {
+        std::lock_guard<std::mutex> lock(this->idMutex_);
+        face_ids = this->face_ids_.spare < 0;
+        identity_ids = this->identity_ids_.spare < 0;
+    }
+    // 在锁外访问数据库，reserve() 期间照常从当前块分配
+    int64_t face_first = face_ids ? this->database_->reserve_ids(kIdBlock) : -1;
+    int64_t identity_first = identity_ids ? this->database_->reserve_identity_ids(kIdBlock) : -1;
+    std::lock_guard<std::mutex> lock(this->idMutex_);
+    if (face_first >= 0)
+    {
+        this->face_ids_.spare = face_first;
+    }
+    if (identity_first >= 0)
+    {
+        this->identity_ids_.spare = identity_first;
+    }
+}
+
+bool FaceJournal::append(const Facedata &face, const std::string &img_path)
+{
+    if (face.id <= 0 || face.identity_id < 0)
+    {
+        LOGE("人脸没有预留 id，拒绝入队");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->queue_.push_back({face, img_path});
+        ++this->appended_;
+    }
+    this->wake_.notify_one();
+    return true;
+}
+
+bool FaceJournal::flush()
+{
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    uint64_t target = this->appended_;
+    // 有失败的记录（或正在重试）时要求写线程立即再试一轮，不等重试定时器
+    uint64_t attempt = this->attempts_;
+    if (this->busy_ || !this->failed_.empty())
+    {
+        attempt += this->busy_ ? 2 : 1;
+        this->retry_now_ = true;
+        this->wake_.notify_one();
+    }
+    this->drained_.wait(lock, [&]
+                        { return this->completed_ >= target && !this->busy_ &&
+                                 (this->failed_.empty() || this->attempts_ >= attempt); });
+    return this->failed_.empty();
+}
+
+size_t FaceJournal::pending() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return static_cast<size_t>(this->appended_ - this->completed_) + this->failed_.size();
+}
+
+bool FaceJournal::in_flight(uint64_t id) const
+{
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->in_flight_.count(id) > 0;
+}
+
+// 读取日志：文件头不对时视为空日志；遇到不完整或校验失败的记录即停止，并截掉这部分尾部
+bool FaceJournal::read_records(std::vector<Record> &records)
+{
+    off_t size = ::lseek(this->fd_, 0, SEEK_END);
+    std::string data(size > 0 ? static_cast<size_t>(size) : 0, '\0');
+    if (size > 0 && ::pread(this->fd_, data.data(), data.size(), 0) != size)
+    {
+        LOGE("读取注册日志失败: " << strerror(errno));
+        ::close(this->fd_);
+        this->fd_ = -1;
+        return false;
+    }
+
+    const char *in = data.data();
+    const char *end = in + data.size();
+    uint32_t version = 0;
+    if (data.size() >= kHeaderSize && memcmp(in, kMagic, sizeof(kMagic)) == 0)
+    {
+        in += sizeof(kMagic);
+        get(in, end, version);
+    }
+    if (version != kVersion)
+    {
+        if (!data.empty())
+        {
+            LOGW("注册日志格式不识别，丢弃: " << this->path_);
+        }
+        std::string header(kMagic, sizeof(kMagic));
+        put(header, kVersion);
+        if (::ftruncate(this->fd_, 0) != 0 || ::pwrite(this->fd_, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size()) ||
+            ::fdatasync(this->fd_) != 0)
+        {
+            LOGE("初始化注册日志失败: " << strerror(errno));
+            ::close(this->fd_);
+            this->fd_ = -1;
+            return false;
+        }
+        this->journal_size_ = kHeaderSize;
+        return true;
+    }
+
+    while (in < end)
+    {
+        const char *record = in;
+        uint32_t length = 0;
+        uint32_t crc = 0;
+        if (!get(in, end, length) || !get(in, end, crc) || length > kMaxPayload ||
+            static_cast<size_t>(end - in) < length || crc32(in, length) != crc)
+        {
+            LOGW("注册日志尾部不完整，截断 " << (end - record) << " 字节");
+            in = record;
+            break;
+        }
+
+        const char *payload_end = in + length;
+        Record r;
+        int64_t id = 0;
+        int64_t identity_id = 0;
+        uint32_t dimensions = 0;
+        bool ok = get(in, payload_end, id) && get(in, payload_end, identity_id) &&
+                  get_string(in, payload_end, r.face.name) && get_string(in, payload_end, r.img_path) &&
+                  get(in, payload_end, dimensions) &&
+                  static_cast<size_t>(payload_end - in) == dimensions * sizeof(float);
+        if (!ok)
+        {
+            LOGW("注册日志记录格式错误，截断 " << (end - record) << " 字节");
+            in = record;
+            break;
+        }
+        r.face.id = static_cast<int>(id);
+        r.face.identity_id = static_cast<int>(identity_id);
+        r.face.embedding.resize(dimensions);
+        memcpy(r.face.embedding.data(), in, dimensions * sizeof(float));
+        r.journaled = true;
+        in = payload_end;
+        records.push_back(std::move(r));
+    }
+
+    this->journal_size_ = static_cast<size_t>(in - data.data());
+    if (this->journal_size_ != data.size() && ::ftruncate(this->fd_, static_cast<off_t>(this->journal_size_)) != 0)
+    {
+        LOGE("截断注册日志失败: " << strerror(errno));
+    }
+    return true;
+}
+
+bool FaceJournal::write_records(std::vector<Record> &records)
+{
+    if (this->fd_ < 0)
+    {
+        return false;
+    }
+
+    std::string buffer;
+    std::string payload;
+    for (const Record &r : records)
+    {
+        if (r.journaled)
+        {
+            continue;
+        }
+        payload.clear();
+        put(payload, static_cast<int64_t>(r.face.id));
+        put(payload, static_cast<int64_t>(r.face.identity_id));
+        put(payload, static_cast<uint32_t>(r.face.name.size()));
+        payload.append(r.face.name);
+        put(payload, static_cast<uint32_t>(r.img_path.size()));
+        payload.append(r.img_path);
+        put(payload, static_cast<uint32_t>(r.face.embedding.size()));
+        payload.append(reinterpret_cast<const char *>(r.face.embedding.data()), r.face.embedding.size() * sizeof(float));
+
+        put(buffer, static_cast<uint32_t>(payload.size()));
+        put(buffer, crc32(payload.data(), payload.size()));
+        buffer.append(payload);
+    }
+    if (buffer.empty())
+    {
+        return true;
+    }
+
+    // 一组记录一次写入、一次 fdatasync
+    if (::lseek(this->fd_, static_cast<off_t>(this->journal_size_), SEEK_SET) < 0 ||
+        !write_all(this->fd_, buffer.data(), buffer.size()) || ::fdatasync(this->fd_) != 0)
+    {
+        LOGE("写入注册日志失败: " << strerror(errno));
+        if (::ftruncate(this->fd_, static_cast<off_t>(this->journal_size_)) != 0)
+        {
+            LOGE("回退注册日志失败: " << strerror(errno));
+        }
+        return false;
+    }
+    this->journal_size_ += buffer.size();
+    for (Record &r : records)
+    {
+        r.journaled = true;
+    }
+    return true;
+}
+
+// 写入数据库；连同之前失败的记录一起写，全部成功后日志里的内容都已落到数据库，可以截断
+// 先把还不在日志中的记录（新的一组，或之前写日志失败的）写入日志，写日志失败也照常写数据库
+bool FaceJournal::apply(std::vector<Record> &records)
+{
+    std::vector<Record> batch;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        batch.swap(this->failed_);
+    }
+    batch.insert(batch.end(), std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
+    if (batch.empty())
+    {
+        return true;
+    }
+    this->write_records(batch);
+
+    std::vector<Facedata> faces;
+    std::vector<std::string> img_paths;
+    faces.reserve(batch.size());
+    img_paths.reserve(batch.size());
+    for (const Record &r : batch)
+    {
+        faces.push_back(r.face);
+        img_paths.push_back(r.img_path);
+    }
+
+    bool ok = this->database_->insert_journaled(faces, img_paths) >= 0;
+    if (!ok)
+    {
+        size_t unjournaled = std::count_if(batch.begin(), batch.end(), [](const Record &r)
+                                           { return !r.journaled; });
+        LOGE("注册日志写入数据库失败，" << batch.size() << " 条记录稍后重试（其中 " << unjournaled << " 条不在日志中）");
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->failed_.swap(batch);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        for (const Record &r : batch)
+        {
+            this->in_flight_.erase(static_cast<uint64_t>(r.face.id));
+        }
+    }
+    // 写入时可能改用了其他连接创建的同名身份，缓存随之更新
+    this->remember_identities(faces);
+    if (this->fd_ >= 0 && this->journal_size_ > kHeaderSize)
+    {
+        if (::ftruncate(this->fd_, kHeaderSize) == 0)
+        {
+            this->journal_size_ = kHeaderSize;
+        }
+        else
+        {
+            LOGE("截断注册日志失败: " << strerror(errno));
+        }
+    }
+    return true;
+}
+
+void FaceJournal::run()
+{
+    std::vector<Record> batch;
+    while (true)
+    {
+        bool last;
+        bool refill;
+        bool work;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            auto ready = [this]
+            { return this->stopping_ || this->retry_now_ || this->refill_ || !this->queue_.empty(); };
+            if (this->failed_.empty())
+            {
+                this->wake_.wait(lock, ready);
+            }
+            else
+            {
+                // 有写入失败的记录时定时醒来重试，不必等下一次注册
+                this->wake_.wait_for(lock, std::chrono::milliseconds(DATABASE_JOURNAL_RETRY_MS), ready);
+            }
+            refill = this->refill_;
+            this->refill_ = false;
+            // 退出前队列已空时再重试一次失败的记录
+            last = this->stopping_ && this->queue_.empty();
+            if (last && this->failed_.empty())
+            {
+                break;
+            }
+            // 只为预留 id 醒来时不写入；没有 refill 又没有其他条件说明是重试定时到了
+            work = this->stopping_ || this->retry_now_ || !this->queue_.empty() || !refill;
+            if (work)
+            {
+                // 取走队列中积累的全部记录作为一组提交
+                batch.swap(this->queue_);
+                this->retry_now_ = false;
+                this->busy_ = true;
+            }
+        }
+
+        // 先预留下一块 id，reserve() 不必等这一组写完
+        if (refill)
+        {
+            this->refill_blocks();
+        }
+        if (!work)
+        {
+            continue;
+        }
+
+        size_t count = batch.size();
+        this->apply(batch);
+        batch.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex_);
+            this->completed_ += count;
+            this->busy_ = false;
+            ++this->attempts_;
+        }
+        this->drained_.notify_all();
+        if (last)
+        {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    if (!this->failed_.empty())
+    {
+        size_t unjournaled = std::count_if(this->failed_.begin(), this->failed_.end(), [](const Record &r)
+                                           { return !r.journaled; });
+        LOGE("退出时仍有 " << this->failed_.size() << " 条注册未写入数据库，其中 " << unjournaled << " 条不在日志中，已丢失");
+    }
+}
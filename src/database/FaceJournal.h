@@ -0,0 +1,112 @@
+#pragma once
+#include "common.h"
+#include "FaceDatabase.h"
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// 注册的写后日志：调用方先用 reserve() 拿到人脸 id 和身份，立即加入内存人脸库，再 append() 入队就返回，
+// 不等待磁盘；后台线程把队列里积累的记录一次性追加到日志文件并 fdatasync（组提交），
+// 再在一个事务里写入数据库，提交落盘后截断日志
+// 进程崩溃时日志中完整的记录（长度 + CRC 校验）在下次启动时重放写入数据库，写入按 id 去重，重放幂等
+// 写入数据库失败的记录留在内存中，每隔 DATABASE_JOURNAL_RETRY_MS 重试，直到成功才截断日志
+class FaceJournal
+{
+public:
+    // 打开日志文件，重放上次未写入数据库的记录，再启动后台写线程
+    // 日志文件打不开时仍可使用，只是没有崩溃保护
+    static std::unique_ptr<FaceJournal> create(FaceDatabase *database, const std::string &path);
+
+    FaceJournal(FaceDatabase *database, const std::string &path);
+    FaceJournal(const FaceJournal &) = delete;
+    FaceJournal &operator=(const FaceJournal &) = delete;
+
+    // 写完队列中的记录后退出
+    ~FaceJournal();
+
+    // 为人脸分配数据库 id 和身份 id，写回 face；不访问数据库
+    // id 取自预留的块，用掉一块时换用后台线程预留好的下一块；身份按姓名查缓存，新姓名分配新的身份 id，
+    // 身份在写入数据库时才创建（其他连接已创建同名身份时改用它的 id）
+    // 只有两块都用完、后台线程还没来得及预留时才在调用线程上同步预留
+    bool reserve(Facedata &face);
+
+    // 放弃 reserve() 分配的、不会入队的 id（如加入人脸库失败）
+    void release(uint64_t id);
+
+    // 记下其他途径（批量注册）写入数据库的人脸的身份，供之后 reserve() 按姓名查找
+    void remember_identities(const std::vector<Facedata> &faces);
+
+    // 已 reserve() 的人脸入队，由后台线程落盘
+    bool append(const Facedata &face, const std::string &img_path);
+
+    // 等待此前入队的记录都写入数据库，之前失败的记录立即重试一次；仍有记录写入失败时返回 false，
+    // 此时数据库中缺少已加入人脸库的人脸，调用方不应按数据库做删除或查询
+    // 失败的记录由后台线程定时重试，其中已写入日志的在进程退出后下次启动重放
+    bool flush();
+
+    // 尚未写入数据库的记录数
+    size_t pending() const;
+
+    // id 已由 reserve() 分配但还没有写入数据库
+    bool in_flight(uint64_t id) const;
+
+private:
+    struct Record
+    {
+        Facedata face;
+        std::string img_path;
+        bool journaled = false; // 是否已写入日志文件
+    };
+
+    // 读取日志中完整的记录，截断损坏的尾部
+    bool read_records(std::vector<Record> &records);
+
+    // 把尚未写入日志的记录追加到日志并 fdatasync，成功后标记为已写入；失败时日志回退到写入前的长度
+    bool write_records(std::vector<Record> &records);
+
+    // 连同之前失败的记录一起写入日志和数据库，全部写入数据库后截断日志；失败的记录留待重试
+    bool apply(std::vector<Record> &records);
+
+    // 从数据库按块预留的 id：当前块 [next, end)，spare 为预留好的下一块起点（-1 表示没有）
+    struct IdBlock
+    {
+        int64_t next = 0;
+        int64_t end = 0;
+        int64_t spare = -1;
+    };
+
+    // 从 block 取一个 id，当前块用完时换用下一块并置 refill；没有下一块时同步预留。在 idMutex_ 下调用
+    int64_t take(IdBlock &block, int64_t (FaceDatabase::*reserve)(size_t), bool &refill);
+
+    // 为没有下一块的 IdBlock 预留下一块，预留时不持锁
+    void refill_blocks();
+
+    // 后台写线程
+    void run();
+
+    FaceDatabase *database_;
+    std::string path_;
+    int fd_ = -1;           // 日志文件，打不开时为 -1
+    size_t journal_size_ = 0; // 日志中已落盘的字节数
+
+    std::mutex idMutex_;
+    IdBlock face_ids_;
+    IdBlock identity_ids_;
+    std::unordered_map<std::string, int64_t> identities_; // 姓名 -> 身份 id
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;    // 有新记录或要退出时唤醒写线程
+    std::condition_variable drained_; // 一组记录写完时唤醒 flush()
+    std::vector<Record> queue_;
+    std::vector<Record> failed_; // 写入数据库失败的记录，定时或随下一组一并重试
+    std::unordered_set<uint64_t> in_flight_; // 已分配 id、尚未写入数据库的人脸
+    uint64_t appended_ = 0;      // 入队的记录总数
+    uint64_t completed_ = 0;     // 已处理（写入或失败）的记录总数
+    uint64_t attempts_ = 0;      // 写线程完成的写入轮数
+    bool busy_ = false;          // 写线程正在写入一组记录
+    bool retry_now_ = false;     // flush() 要求立即重试失败的记录
+    bool refill_ = false;        // 有 id 块用完，要写线程预留下一块
+    bool stopping_ = false;
+    std::thread writer_;
+};
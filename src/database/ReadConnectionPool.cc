@@ -0,0 +1,97 @@
+#include "ReadConnectionPool.h"
+
+ReadConnectionPool::Lease::Lease(Lease &&other) noexcept
+    : pool_(other.pool_),
+      slot_(other.slot_),
+      db_(other.db_),
+      statements_(other.statements_),
+      writer_lock_(std::move(other.writer_lock_))
+{
+    other.pool_ = nullptr;
+    other.db_ = nullptr;
+}
+
+ReadConnectionPool::Lease::~Lease()
+{
+    if (this->pool_ != nullptr)
+    {
+        this->pool_->release(this->slot_);
+    }
+}
+
+ReadConnectionPool::~ReadConnectionPool()
+{
+    this->close();
+}
+
+void ReadConnectionPool::close()
+{
+    // 语句须在关闭连接前销毁
+    for (std::unique_ptr<Connection> &connection : this->connections_)
+    {
+        connection->statements.clear();
+        sqlite3_close(connection->db);
+    }
+    this->connections_.clear();
+    this->idle_.clear();
+}
+
+void ReadConnectionPool::open(const std::string &path, size_t size, sqlite3 *writer, std::mutex &writer_mutex, StatementCache &writer_statements)
+{
+    this->writer_ = writer;
+    this->writer_mutex_ = &writer_mutex;
+    this->writer_statements_ = &writer_statements;
+
+    // 内存数据库每个连接各是一个库，只能共用写连接
+    if (writer == nullptr || path.empty() || path == ":memory:")
+    {
+        return;
+    }
+
+    // 连接只由借到它的线程使用，不需要 SQLite 内部的连接锁
+    for (size_t i = 0; i < size; ++i)
+    {
+        std::unique_ptr<Connection> connection = std::make_unique<Connection>();
+        if (sqlite3_open_v2(path.c_str(), &connection->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+        {
+            LOGW("打开只读连接失败: " << sqlite3_errmsg(connection->db) << "，已打开 " << this->connections_.size() << " 个");
+            sqlite3_close(connection->db);
+            break;
+        }
+        // 写连接做检查点时读连接可能短暂忙碌，等待而不是直接失败
+        sqlite3_busy_timeout(connection->db, 1000);
+        this->idle_.push_back(this->connections_.size());
+        this->connections_.push_back(std::move(connection));
+    }
+}
+
+ReadConnectionPool::Lease ReadConnectionPool::acquire()
+{
+    Lease lease;
+    if (this->connections_.empty())
+    {
+        lease.db_ = this->writer_;
+        lease.statements_ = this->writer_statements_;
+        lease.writer_lock_ = std::unique_lock<std::mutex>(*this->writer_mutex_);
+        return lease;
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    this->available_.wait(lock, [this]
+                          { return !this->idle_.empty(); });
+    lease.pool_ = this;
+    lease.slot_ = this->idle_.back();
+    this->idle_.pop_back();
+    lease.db_ = this->connections_[lease.slot_]->db;
+    lease.statements_ = &this->connections_[lease.slot_]->statements;
+    return lease;
+}
+
+void ReadConnectionPool::release(size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->idle_.push_back(slot);
+    }
+    this->available_.notify_one();
+}
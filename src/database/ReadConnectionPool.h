@@ -0,0 +1,74 @@
+#pragma once
+#include <sqlite3.h>
+#include "common.h"
+#include "StatementCache.h"
+#include <condition_variable>
+
+// 只读连接池：WAL 模式下读连接之间、读连接与写连接之间互不阻塞，查询可以随线程数扩展
+// 每个连接有自己的预编译语句缓存，同一时刻只借给一个线程
+// 池为空（连接数为 0、内存数据库或打开失败）时借出写连接，并在借用期间持有写连接的锁
+class ReadConnectionPool
+{
+public:
+    // 借出的连接，析构时归还
+    class Lease
+    {
+    public:
+        Lease(Lease &&other) noexcept;
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        Lease &operator=(Lease &&) = delete;
+        ~Lease();
+
+        sqlite3 *db() const { return this->db_; }
+
+        // 取出本连接缓存的语句，同 StatementCache::prepare
+        CachedStatement prepare(const char *sql) { return this->statements_->prepare(this->db_, sql); }
+
+    private:
+        friend class ReadConnectionPool;
+        Lease() = default;
+
+        ReadConnectionPool *pool_ = nullptr; // 借自连接池时不为空
+        size_t slot_ = 0;
+        sqlite3 *db_ = nullptr;
+        StatementCache *statements_ = nullptr;
+        std::unique_lock<std::mutex> writer_lock_; // 借用写连接时持有
+    };
+
+    ReadConnectionPool() = default;
+    ReadConnectionPool(const ReadConnectionPool &) = delete;
+    ReadConnectionPool &operator=(const ReadConnectionPool &) = delete;
+    ~ReadConnectionPool();
+
+    // 打开 size 个只读连接；writer 及其锁和语句缓存在池为空时使用，须比连接池存活更久
+    // 须在写连接建好表之后调用，只调用一次
+    void open(const std::string &path, size_t size, sqlite3 *writer, std::mutex &writer_mutex, StatementCache &writer_statements);
+
+    // 关闭全部只读连接；写连接关闭前调用，由写连接在关闭时合并 WAL。此时不能有借出的连接
+    void close();
+
+    // 借出一个连接，全部在使用时等待归还
+    Lease acquire();
+
+    // 只读连接数，0 表示读取使用写连接
+    size_t size() const { return this->connections_.size(); }
+
+private:
+    struct Connection
+    {
+        sqlite3 *db = nullptr;
+        StatementCache statements;
+    };
+
+    void release(size_t slot);
+
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::vector<size_t> idle_; // 空闲连接的下标
+    std::mutex mutex_;
+    std::condition_variable available_;
+
+    sqlite3 *writer_ = nullptr;
+    std::mutex *writer_mutex_ = nullptr;
+    StatementCache *writer_statements_ = nullptr;
+};
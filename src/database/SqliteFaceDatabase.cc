@@ -0,0 +1,855 @@
+#include "SqliteFaceDatabase.h"
+#include <algorithm>
+
+template <typename Traits>
+SqliteFaceDatabase<Traits>::SqliteFaceDatabase(const std::string &db_path, size_t read_connections)
+    : db_(nullptr),
+      databastpath_(db_path),
+      meta_prefix_(std::string(Traits::faces_table) + "."),
+      dtype_(EmbeddingBlob::dtype_from_name(Traits::dtype))
+{
+    this->sql_.count = expand("SELECT COUNT(*) FROM {faces};");
+    this->sql_.insert = expand("INSERT INTO {faces} (user_name, img_path, face_encoding, identity_id) VALUES (?,?,?,?);");
+    this->sql_.seed_sequence = expand("INSERT INTO sqlite_sequence (name, seq) SELECT '{faces}', (SELECT COALESCE(MAX(id), 0) FROM {faces}) "
+                                      "WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name = '{faces}');");
+    this->sql_.reserve_ids = expand("UPDATE sqlite_sequence SET seq = seq + ? WHERE name = '{faces}' RETURNING seq;");
+    this->sql_.seed_identity_sequence = expand("INSERT INTO sqlite_sequence (name, seq) SELECT '{identities}', (SELECT COALESCE(MAX(id), 0) FROM {identities}) "
+                                               "WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name = '{identities}');");
+    this->sql_.reserve_identity_ids = expand("UPDATE sqlite_sequence SET seq = seq + ? WHERE name = '{identities}' RETURNING seq;");
+    this->sql_.select_identities = expand("SELECT id, user_name FROM {identities};");
+    this->sql_.identity_by_name = expand("SELECT id FROM {identities} WHERE user_name = ?;");
+    this->sql_.insert_identity = expand("INSERT OR IGNORE INTO {identities} (user_name) VALUES (?);");
+    this->sql_.insert_identity_with_id = expand("INSERT OR IGNORE INTO {identities} (id, user_name) VALUES (?,?);");
+    this->sql_.insert_with_id = expand("INSERT OR IGNORE INTO {faces} (id, user_name, img_path, face_encoding, identity_id) VALUES (?,?,?,?,?);");
+    this->sql_.select_all = expand("SELECT id, user_name, img_path, face_encoding, identity_id FROM {faces};");
+    this->sql_.select_arena = expand("SELECT id, user_name, identity_id, face_encoding FROM {faces} ORDER BY id;");
+    this->sql_.select_by_name = expand("SELECT id, user_name, img_path, face_encoding, identity_id FROM {faces} WHERE user_name = ?;");
+    this->sql_.select_by_id = expand("SELECT id, user_name, img_path, face_encoding, identity_id FROM {faces} WHERE id = ?;");
+    this->sql_.ids_by_name = expand("SELECT id FROM {faces} WHERE user_name = ? ORDER BY id;");
+    this->sql_.delete_by_name = expand("DELETE FROM {faces} WHERE user_name = ? RETURNING id;");
+    this->sql_.delete_by_id = expand("DELETE FROM {faces} WHERE id = ?;");
+    this->sql_.change_sequence = expand("SELECT seq FROM sqlite_sequence WHERE name = '{faces}_changes';");
+    this->sql_.oldest_change = expand("SELECT MIN(seq) FROM {faces}_changes;");
+    this->sql_.changes_since = expand("SELECT face_id, identity_id FROM {faces}_changes WHERE seq > ?;");
+    this->sql_.prune_changes = expand("DELETE FROM {faces}_changes WHERE seq <= ?;");
+
+    if (sqlite3_open(this->databastpath_.c_str(), &this->db_) != SQLITE_OK)
+    {
+        LOGE("无法打开数据库: " << sqlite3_errmsg(this->db_));
+    }
+    else
+    {
+        // WAL 模式下读写互不阻塞，提交时只追加日志；同步级别见 DATABASE_SYNCHRONOUS
+        std::string pragmas = std::string("PRAGMA journal_mode=WAL; PRAGMA synchronous=") + DATABASE_SYNCHRONOUS + ";";
+        char *err_msg = nullptr;
+        if (sqlite3_exec(this->db_, pragmas.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK)
+        {
+            LOGW("设置 WAL 模式失败: " << err_msg);
+            sqlite3_free(err_msg);
+        }
+        if (!init_table())
+        {
+            LOGE("初始化表结构失败。");
+        }
+        // 建好表之后再打开只读连接，查询不再与写入争用 dbMutex_
+        this->readers_.open(this->databastpath_, read_connections, this->db_, this->dbMutex_, this->statements_);
+    }
+}
+
+template <typename Traits>
+SqliteFaceDatabase<Traits>::~SqliteFaceDatabase()
+{
+    // 先关闭只读连接，写连接最后关闭时合并 WAL；语句须在关闭连接前销毁
+    this->readers_.close();
+    this->statements_.clear();
+    if (this->db_)
+        sqlite3_close(this->db_);
+}
+
+// 初始化表结构
+template <typename Traits>
+bool SqliteFaceDatabase<Traits>::init_table()
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    std::string sql = expand("CREATE TABLE IF NOT EXISTS {faces} ("
+                             "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                             "user_name TEXT NOT NULL,"
+                             "img_path TEXT NOT NULL,"
+                             "face_encoding BLOB NOT NULL,"
+                             "created_time DATETIME DEFAULT CURRENT_TIMESTAMP,"
+                             "identity_id INTEGER);");
+
+    // 元数据表，各后端共用，key 以表名为前缀
+    const char *sql_meta = "CREATE TABLE IF NOT EXISTS face_meta ("
+                           "key TEXT PRIMARY KEY,"
+                           "value TEXT NOT NULL);";
+
+    char *err_msg = nullptr;
+    if (sqlite3_exec(this->db_, sql.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK)
+    {
+        LOGE("创建表失败: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+    if (sqlite3_exec(this->db_, sql_meta, nullptr, nullptr, &err_msg) != SQLITE_OK)
+    {
+        LOGE("创建元数据表失败: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    // 身份表：一个身份（一个人）对应多张人脸模板
+    std::string sql_identity = expand("CREATE TABLE IF NOT EXISTS {identities} ("
+                                      "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                                      "user_name TEXT NOT NULL UNIQUE,"
+                                      "created_time DATETIME DEFAULT CURRENT_TIMESTAMP);");
+    if (sqlite3_exec(this->db_, sql_identity.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK)
+    {
+        LOGE("创建身份表失败: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    // 姓名索引：按姓名查找、删除走索引而不是全表扫描
+    std::string sql_name_index = expand("CREATE INDEX IF NOT EXISTS idx_{faces}_user_name ON {faces} (user_name);");
+    if (sqlite3_exec(this->db_, sql_name_index.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK)
+    {
+        LOGE("创建姓名索引失败: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    // 旧版本的人脸表没有 identity_id 列，补上该列
+    bool has_identity = false;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(this->db_, expand("PRAGMA table_info({faces});").c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            if (strcmp(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)), "identity_id") == 0)
+            {
+                has_identity = true;
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (!has_identity &&
+        sqlite3_exec(this->db_, expand("ALTER TABLE {faces} ADD COLUMN identity_id INTEGER;").c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK)
+    {
+        LOGE("添加 identity_id 列失败: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    // 按姓名为没有身份的旧数据回填身份（原先同名会被注册为 name1、name2，这里不做合并）
+    std::string sql_backfill = expand("INSERT OR IGNORE INTO {identities} (user_name) "
+                                      "SELECT DISTINCT user_name FROM {faces} WHERE identity_id IS NULL;"
+                                      "UPDATE {faces} SET identity_id = "
+                                      "(SELECT id FROM {identities} WHERE {identities}.user_name = {faces}.user_name) "
+                                      "WHERE identity_id IS NULL;");
+    if (sqlite3_exec(this->db_, sql_backfill.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK)
+    {
+        LOGE("回填身份失败: " << err_msg);
+        sqlite3_free(err_msg);
+        return false;
+    }
+
+    // 旧版本的更新触发器不记录改名，删掉后按下面的定义重建；放在一个事务中，其他连接不会漏记变更
+    std::string sql_trigger = expand("SELECT sql FROM sqlite_master WHERE type = 'trigger' AND name = '{faces}_log_update';");
+    bool stale_trigger = false;
+    if (sqlite3_prepare_v2(this->db_, sql_trigger.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char *definition = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+            stale_trigger = definition == nullptr || strstr(definition, "user_name") == nullptr;
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // 变更日志：人脸表每插入、更新、删除一行记一条，序号单调递增；重启时只按快照之后的变更更新索引
+    // 更新（特征、身份或姓名）同时记下旧身份和新身份，质心模式据此重算两边的质心
+    std::string sql_changes = expand("CREATE TABLE IF NOT EXISTS {faces}_changes ("
+                                     "seq INTEGER PRIMARY KEY AUTOINCREMENT,"
+                                     "face_id INTEGER NOT NULL,"
+                                     "identity_id INTEGER);"
+                                     "CREATE TRIGGER IF NOT EXISTS {faces}_log_insert AFTER INSERT ON {faces} BEGIN "
+                                     "INSERT INTO {faces}_changes (face_id, identity_id) VALUES (NEW.id, NEW.identity_id); END;"
+                                     "CREATE TRIGGER IF NOT EXISTS {faces}_log_update AFTER UPDATE OF face_encoding, identity_id, user_name ON {faces} BEGIN "
+                                     "INSERT INTO {faces}_changes (face_id, identity_id) VALUES (OLD.id, OLD.identity_id);"
+                                     "INSERT INTO {faces}_changes (face_id, identity_id) VALUES (NEW.id, NEW.identity_id); END;"
+                                     "CREATE TRIGGER IF NOT EXISTS {faces}_log_delete AFTER DELETE ON {faces} BEGIN "
+                                     "INSERT INTO {faces}_changes (face_id, identity_id) VALUES (OLD.id, OLD.identity_id); END;");
+    if (stale_trigger)
+    {
+        sql_changes = expand("BEGIN IMMEDIATE; DROP TRIGGER IF EXISTS {faces}_log_update;") + sql_changes + "COMMIT;";
+    }
+    if (sqlite3_exec(this->db_, sql_changes.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK)
+    {
+        LOGE("创建变更日志失败: " << err_msg);
+        sqlite3_free(err_msg);
+        if (stale_trigger)
+        {
+            sqlite3_exec(this->db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+        }
+        return false;
+    }
+    return true;
+}
+
+// 查询数据库人脸数量
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::get_face_count()
+{
+    ReadConnectionPool::Lease reader = this->readers_.acquire();
+    const char *sql = this->sql_.count.c_str();
+    int64_t count = 0;
+
+    CachedStatement stmt = reader.prepare(sql);
+    if (!stmt)
+        return count;
+
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        count = sqlite3_column_int64(stmt, 0);
+    }
+    return count;
+}
+
+// 插入操作
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::insert(const Facedata &face, const std::string &img_path)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    return this->insert_locked(face, img_path, nullptr);
+}
+
+// 批量插入：每 DATABASE_BATCH_ROWS 行一个事务，提交次数（fsync）从每行一次降到每批一次
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::insert_batch(std::vector<Facedata> &faces, const std::vector<std::string> &img_paths)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    int64_t inserted = 0;
+    for (size_t begin = 0; begin < faces.size(); begin += DATABASE_BATCH_ROWS)
+    {
+        size_t end = std::min<size_t>(begin + DATABASE_BATCH_ROWS, faces.size());
+        bool ok = sqlite3_exec(this->db_, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK;
+        for (size_t i = begin; ok && i < end; ++i)
+        {
+            int64_t identity_id = -1;
+            int64_t row_id = this->insert_locked(faces[i], i < img_paths.size() ? img_paths[i] : "", &identity_id);
+            faces[i].id = static_cast<int>(row_id);
+            faces[i].identity_id = row_id > 0 ? static_cast<int>(identity_id) : -1;
+        }
+        if (!ok || sqlite3_exec(this->db_, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            LOGE("批量插入失败: " << sqlite3_errmsg(this->db_));
+            sqlite3_exec(this->db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+            for (size_t i = begin; i < end; ++i)
+            {
+                faces[i].id = -1;
+                faces[i].identity_id = -1;
+            }
+            continue;
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            inserted += faces[i].id > 0;
+        }
+    }
+    return inserted;
+}
+
+// 预留 count 个连续的人脸 id：把 AUTOINCREMENT 的序列号推后 count，之后自增分配的 id 不会与之重复
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::reserve_ids(size_t count)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    return this->reserve_sequence_locked(this->sql_.seed_sequence, this->sql_.reserve_ids, count);
+}
+
+// 预留 count 个连续的身份 id，做法同 reserve_ids
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::reserve_identity_ids(size_t count)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    return this->reserve_sequence_locked(this->sql_.seed_identity_sequence, this->sql_.reserve_identity_ids, count);
+}
+
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::reserve_sequence_locked(const std::string &seed, const std::string &reserve, size_t count)
+{
+    {
+        // 表还没插入过数据时序列号没有记录，先补上
+        CachedStatement stmt = this->statements_.prepare(this->db_, seed.c_str());
+        if (!stmt || sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            LOGE("预留 id 失败: " << sqlite3_errmsg(this->db_));
+            return -1;
+        }
+    }
+
+    CachedStatement stmt = this->statements_.prepare(this->db_, reserve.c_str());
+    if (!stmt)
+        return -1;
+    sqlite3_bind_int64(stmt, 1, static_cast<int64_t>(count));
+
+    int64_t first = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        first = sqlite3_column_int64(stmt, 0) - static_cast<int64_t>(count) + 1;
+    }
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        LOGE("预留 id 失败: " << sqlite3_errmsg(this->db_));
+        first = -1;
+    }
+    return first;
+}
+
+// 读取全部身份，写后日志启动时用来建立姓名到身份的缓存
+template <typename Traits>
+bool SqliteFaceDatabase<Traits>::load_identities(std::vector<std::pair<int64_t, std::string>> &identities)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    CachedStatement stmt = this->statements_.prepare(this->db_, this->sql_.select_identities.c_str());
+    if (!stmt)
+        return false;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const char *name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+        identities.emplace_back(sqlite3_column_int64(stmt, 0), name ? name : "");
+    }
+    if (rc != SQLITE_DONE)
+    {
+        LOGE("读取身份失败: " << sqlite3_errmsg(this->db_));
+        return false;
+    }
+    return true;
+}
+
+// 按写后日志写入：id 和身份已预先分配，id 已存在的跳过，重放幂等
+// 提交后日志即被截断，所以本事务强制同步落盘，不受 DATABASE_SYNCHRONOUS 影响
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::insert_journaled(std::vector<Facedata> &faces, const std::vector<std::string> &img_paths)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    bool ok = sqlite3_exec(this->db_, "PRAGMA synchronous=FULL; BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    int64_t written = 0;
+    {
+        // 新身份在这里按预分配的 id 创建；没有创建（身份已存在）时按姓名确认身份 id
+        CachedStatement identity = this->statements_.prepare(this->db_, this->sql_.insert_identity_with_id.c_str());
+        CachedStatement stmt = this->statements_.prepare(this->db_, this->sql_.insert_with_id.c_str());
+        ok = ok && identity && stmt;
+        std::vector<uint8_t> blob;
+        for (size_t i = 0; ok && i < faces.size(); ++i)
+        {
+            Facedata &face = faces[i];
+            const std::string &img_path = i < img_paths.size() ? img_paths[i] : std::string();
+
+            sqlite3_bind_int64(identity, 1, face.identity_id);
+            sqlite3_bind_text(identity, 2, face.name.c_str(), -1, SQLITE_STATIC);
+            ok = sqlite3_step(identity) == SQLITE_DONE;
+            if (ok && sqlite3_changes(this->db_) == 0)
+            {
+                CachedStatement existing = this->statements_.prepare(this->db_, this->sql_.identity_by_name.c_str());
+                ok = existing != nullptr;
+                if (ok)
+                {
+                    sqlite3_bind_text(existing, 1, face.name.c_str(), -1, SQLITE_STATIC);
+                    ok = sqlite3_step(existing) == SQLITE_ROW;
+                }
+                if (ok)
+                {
+                    face.identity_id = static_cast<int>(sqlite3_column_int64(existing, 0));
+                }
+            }
+            if (ok)
+            {
+                sqlite3_bind_int64(stmt, 1, face.id);
+                sqlite3_bind_text(stmt, 2, face.name.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_text(stmt, 3, img_path.c_str(), -1, SQLITE_STATIC);
+                EmbeddingBlob::encode(face.embedding.data(), face.embedding.size(), this->dtype_, blob);
+                sqlite3_bind_blob(stmt, 4, blob.data(), static_cast<int>(blob.size()), SQLITE_STATIC);
+                sqlite3_bind_int64(stmt, 5, face.identity_id);
+                ok = sqlite3_step(stmt) == SQLITE_DONE;
+            }
+            if (!ok)
+            {
+                LOGE("写入注册日志记录失败: " << sqlite3_errmsg(this->db_));
+            }
+            written += sqlite3_changes(this->db_);
+            sqlite3_reset(identity);
+            sqlite3_reset(stmt);
+        }
+    }
+    if (ok && sqlite3_exec(this->db_, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOGE("提交注册日志记录失败: " << sqlite3_errmsg(this->db_));
+        ok = false;
+    }
+    if (!ok)
+    {
+        sqlite3_exec(this->db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+        written = -1;
+    }
+    std::string restore = std::string("PRAGMA synchronous=") + DATABASE_SYNCHRONOUS + ";";
+    sqlite3_exec(this->db_, restore.c_str(), nullptr, nullptr, nullptr);
+    return written;
+}
+
+// 插入一行
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::insert_locked(const Facedata &face, const std::string &img_path, int64_t *identity_out)
+{
+    if (face.embedding.empty())
+    {
+        LOGE("特征向量为空，拒绝插入数据库");
+        return false;
+    }
+    // 同名即同一身份，新照片作为该身份的一张模板
+    int64_t identity_id = this->identity_id_locked(face.name);
+    if (identity_id < 0)
+        return -1;
+    if (identity_out)
+        *identity_out = identity_id;
+
+    const char *sql = this->sql_.insert.c_str();
+
+    CachedStatement stmt = this->statements_.prepare(this->db_, sql);
+    if (!stmt)
+        return false;
+
+    // 1. 绑定姓名
+    sqlite3_bind_text(stmt, 1, face.name.c_str(), -1, SQLITE_STATIC);
+
+    // 绑定图片路径
+    sqlite3_bind_text(stmt, 2, img_path.c_str(), -1, SQLITE_STATIC);
+    // 2. 绑定特征向量 (BLOB)，按本后端的存储格式编码
+    std::vector<uint8_t> blob;
+    EmbeddingBlob::encode(face.embedding.data(), face.embedding.size(), this->dtype_, blob);
+    sqlite3_bind_blob(stmt, 3, blob.data(), static_cast<int>(blob.size()), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 4, identity_id);
+
+    int64_t row_id = -1;
+
+    if (sqlite3_step(stmt) == SQLITE_DONE)
+    {
+        row_id = sqlite3_last_insert_rowid(this->db_);
+    }
+    else
+    {
+        LOGE("插入失败: " << sqlite3_errmsg(this->db_));
+    }
+
+    return row_id;
+}
+
+// 加载所有人脸数据
+template <typename Traits>
+std::vector<Facedata> SqliteFaceDatabase<Traits>::load_all_faces()
+{
+    ReadConnectionPool::Lease reader = this->readers_.acquire();
+    std::vector<Facedata> results;
+    const char *sql = this->sql_.select_all.c_str();
+
+    CachedStatement stmt = reader.prepare(sql);
+    if (!stmt)
+        return results;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        Facedata fd;
+        fd.id = sqlite3_column_int(stmt, 0);
+        fd.name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+        fd.identity_id = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 4);
+
+        // 从 BLOB 解码特征（带头的 f16/f32，或旧版本的裸 f32）
+        const void *blobPtr = sqlite3_column_blob(stmt, 3);
+        int totalBytes = sqlite3_column_bytes(stmt, 3);
+        if (EmbeddingBlob::decode(blobPtr, totalBytes, fd.embedding))
+        {
+            results.push_back(fd);
+        }
+    }
+    return results;
+}
+
+// 流式加载到连续特征区：只读取 id、姓名、身份和特征，不逐行构造 Facedata
+template <typename Traits>
+bool SqliteFaceDatabase<Traits>::load_arena(FaceArena &arena)
+{
+    ReadConnectionPool::Lease reader = this->readers_.acquire();
+    CachedStatement count = reader.prepare(this->sql_.count.c_str());
+    if (count && sqlite3_step(count) == SQLITE_ROW)
+    {
+        // 先按行数预留，第一行确定维度后特征区一次分配到位
+        arena.reserve(static_cast<size_t>(sqlite3_column_int64(count, 0)));
+    }
+
+    const char *sql = this->sql_.select_arena.c_str();
+    CachedStatement stmt = reader.prepare(sql);
+    if (!stmt)
+        return false;
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const void *blobPtr = sqlite3_column_blob(stmt, 3);
+        int totalBytes = sqlite3_column_bytes(stmt, 3);
+        size_t dimensions = EmbeddingBlob::dimensions(blobPtr, totalBytes);
+        if (dimensions == 0)
+        {
+            continue;
+        }
+        // 特征直接解码到特征区的行里，f16 在这里展开
+        const char *name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+        float *row = arena.append_row(sqlite3_column_int(stmt, 0),
+                                      sqlite3_column_type(stmt, 2) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 2),
+                                      std::string_view(name, sqlite3_column_bytes(stmt, 1)), dimensions);
+        if (row != nullptr)
+        {
+            EmbeddingBlob::decode(blobPtr, totalBytes, row);
+        }
+    }
+    if (rc != SQLITE_DONE)
+    {
+        LOGE("加载人脸数据失败: " << sqlite3_errmsg(reader.db()));
+        return false;
+    }
+    return true;
+}
+
+// 数据库通过姓名查找人脸数据
+template <typename Traits>
+std::vector<Facedata> SqliteFaceDatabase<Traits>::find_by_name(const std::string &name)
+{
+    ReadConnectionPool::Lease reader = this->readers_.acquire();
+    std::vector<Facedata> results;
+    const char *sql = this->sql_.select_by_name.c_str();
+
+    CachedStatement stmt = reader.prepare(sql);
+    if (!stmt)
+        return results;
+
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        Facedata fd;
+        fd.id = sqlite3_column_int(stmt, 0);
+        fd.name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+        fd.identity_id = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 4);
+
+        // 从 BLOB 解码特征（带头的 f16/f32，或旧版本的裸 f32）
+        const void *blobPtr = sqlite3_column_blob(stmt, 3);
+        int totalBytes = sqlite3_column_bytes(stmt, 3);
+        if (EmbeddingBlob::decode(blobPtr, totalBytes, fd.embedding))
+        {
+            results.push_back(fd);
+        }
+    }
+    return results;
+}
+
+// 数据库通过id号查找人脸数据
+template <typename Traits>
+std::vector<Facedata> SqliteFaceDatabase<Traits>::find_by_id(int id)
+{
+    ReadConnectionPool::Lease reader = this->readers_.acquire();
+    std::vector<Facedata> results;
+    const char *sql = this->sql_.select_by_id.c_str();
+
+    CachedStatement stmt = reader.prepare(sql);
+    if (!stmt)
+        return results;
+
+    sqlite3_bind_int(stmt, 1, id);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        Facedata fd;
+        fd.id = sqlite3_column_int(stmt, 0);
+        fd.name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+        fd.identity_id = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 4);
+
+        // 从 BLOB 解码特征（带头的 f16/f32，或旧版本的裸 f32）
+        const void *blobPtr = sqlite3_column_blob(stmt, 3);
+        int totalBytes = sqlite3_column_bytes(stmt, 3);
+        if (EmbeddingBlob::decode(blobPtr, totalBytes, fd.embedding))
+        {
+            results.push_back(fd);
+        }
+    }
+    return results;
+}
+
+// 按姓名查找全部人脸 id（走姓名索引，不读取特征）
+template <typename Traits>
+std::vector<int64_t> SqliteFaceDatabase<Traits>::find_ids_by_name(const std::string &name)
+{
+    ReadConnectionPool::Lease reader = this->readers_.acquire();
+    std::vector<int64_t> ids;
+    const char *sql = this->sql_.ids_by_name.c_str();
+
+    CachedStatement stmt = reader.prepare(sql);
+    if (!stmt)
+        return ids;
+
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        ids.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    return ids;
+}
+
+// 按姓名删除全部人脸：单条语句经姓名索引定位并删除，RETURNING 带回被删除的 id
+// 不再调用 find_by_name/delete_by_id（它们会再次锁 dbMutex_）
+template <typename Traits>
+std::vector<int64_t> SqliteFaceDatabase<Traits>::delete_by_name(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    std::vector<int64_t> ids;
+    const char *sql = this->sql_.delete_by_name.c_str();
+
+    CachedStatement stmt = this->statements_.prepare(this->db_, sql);
+    if (!stmt)
+        return ids;
+
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        ids.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    if (rc != SQLITE_DONE)
+    {
+        // 语句失败时整条删除回滚
+        LOGE("按姓名删除失败: " << sqlite3_errmsg(this->db_));
+        ids.clear();
+    }
+    else if (ids.empty())
+    {
+        LOGW("delete_by_name: no face found for name: " << name);
+    }
+    return ids;
+}
+
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::delete_by_id(int id)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    const char *sql = this->sql_.delete_by_id.c_str();
+    CachedStatement stmt = this->statements_.prepare(this->db_, sql);
+    if (!stmt)
+        return false;
+    sqlite3_bind_int(stmt, 1, id);
+
+    int64_t result_id = -1;
+    if (sqlite3_step(stmt) == SQLITE_DONE)
+    {
+        result_id = static_cast<int64_t>(id);
+    }
+    else
+    {
+        LOGE("删除失败");
+    }
+
+    return result_id;
+}
+
+// 当前变更序号，即最后一条变更的序号（删除旧变更后也不会回退）
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::change_sequence()
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    CachedStatement stmt = this->statements_.prepare(this->db_, this->sql_.change_sequence.c_str());
+    if (!stmt)
+        return -1;
+    return sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+}
+
+// 序号大于 sequence 的变更涉及的人脸 id 和身份 id，各自去重
+template <typename Traits>
+bool SqliteFaceDatabase<Traits>::changes_since(int64_t sequence, std::vector<int64_t> &face_ids, std::vector<int64_t> &identity_ids)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    face_ids.clear();
+    identity_ids.clear();
+    int64_t current = 0;
+    {
+        // 序号超过当前序号说明日志不是这个快照对应的数据库
+        CachedStatement latest = this->statements_.prepare(this->db_, this->sql_.change_sequence.c_str());
+        if (!latest)
+            return false;
+        current = sqlite3_step(latest) == SQLITE_ROW ? sqlite3_column_int64(latest, 0) : 0;
+        if (sequence > current)
+        {
+            LOGW("变更序号 " << sequence << " 超过数据库当前序号 " << current);
+            return false;
+        }
+    }
+    {
+        // 序号连续，sequence 之后的第一条变更已被清理说明日志不再完整
+        CachedStatement first = this->statements_.prepare(this->db_, this->sql_.oldest_change.c_str());
+        if (!first || sqlite3_step(first) != SQLITE_ROW)
+            return false;
+        int64_t oldest = sqlite3_column_type(first, 0) == SQLITE_NULL ? current + 1 : sqlite3_column_int64(first, 0);
+        if (current > sequence && oldest > sequence + 1)
+        {
+            LOGW("变更序号 " << sequence << " 之后的变更已被清理");
+            return false;
+        }
+    }
+
+    CachedStatement stmt = this->statements_.prepare(this->db_, this->sql_.changes_since.c_str());
+    if (!stmt)
+        return false;
+    sqlite3_bind_int64(stmt, 1, sequence);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        face_ids.push_back(sqlite3_column_int64(stmt, 0));
+        if (sqlite3_column_type(stmt, 1) != SQLITE_NULL)
+        {
+            identity_ids.push_back(sqlite3_column_int64(stmt, 1));
+        }
+    }
+    if (rc != SQLITE_DONE)
+    {
+        LOGE("读取变更日志失败: " << sqlite3_errmsg(this->db_));
+        return false;
+    }
+    for (std::vector<int64_t> *ids : {&face_ids, &identity_ids})
+    {
+        std::sort(ids->begin(), ids->end());
+        ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+    }
+    return true;
+}
+
+// 删除序号不大于 sequence 的变更
+template <typename Traits>
+bool SqliteFaceDatabase<Traits>::prune_changes(int64_t sequence)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    CachedStatement stmt = this->statements_.prepare(this->db_, this->sql_.prune_changes.c_str());
+    if (!stmt)
+        return false;
+    sqlite3_bind_int64(stmt, 1, sequence);
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
+    {
+        LOGE("清理变更日志失败: " << sqlite3_errmsg(this->db_));
+    }
+    return ok;
+}
+
+// PRAGMA data_version：其他连接提交写入后变化，本连接自己的写入不改变它
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::data_version()
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    CachedStatement stmt = this->statements_.prepare(this->db_, "PRAGMA data_version;");
+    if (!stmt || sqlite3_step(stmt) != SQLITE_ROW)
+        return -1;
+    return sqlite3_column_int64(stmt, 0);
+}
+
+// 读取元数据
+template <typename Traits>
+std::string SqliteFaceDatabase<Traits>::get_meta(const std::string &key)
+{
+    ReadConnectionPool::Lease reader = this->readers_.acquire();
+    const char *sql = "SELECT value FROM face_meta WHERE key = ?;";
+    std::string value;
+
+    CachedStatement stmt = reader.prepare(sql);
+    if (!stmt)
+        return value;
+
+    std::string full_key = this->meta_prefix_ + key;
+    sqlite3_bind_text(stmt, 1, full_key.c_str(), -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        value = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    }
+    return value;
+}
+
+// 写入元数据
+template <typename Traits>
+bool SqliteFaceDatabase<Traits>::set_meta(const std::string &key, const std::string &value)
+{
+    std::lock_guard<std::mutex> lock(this->dbMutex_);
+    const char *sql = "INSERT OR REPLACE INTO face_meta (key, value) VALUES (?,?);";
+
+    CachedStatement stmt = this->statements_.prepare(this->db_, sql);
+    if (!stmt)
+        return false;
+
+    std::string full_key = this->meta_prefix_ + key;
+    sqlite3_bind_text(stmt, 1, full_key.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, value.c_str(), -1, SQLITE_STATIC);
+
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok)
+    {
+        LOGE("写入元数据失败: " << sqlite3_errmsg(this->db_));
+    }
+    return ok;
+}
+
+// 按姓名获取身份 id，不存在时创建
+template <typename Traits>
+int64_t SqliteFaceDatabase<Traits>::identity_id_locked(const std::string &name)
+{
+    CachedStatement insert = this->statements_.prepare(this->db_, this->sql_.insert_identity.c_str());
+    if (!insert)
+        return -1;
+    sqlite3_bind_text(insert, 1, name.c_str(), -1, SQLITE_STATIC);
+    sqlite3_step(insert);
+
+    CachedStatement stmt = this->statements_.prepare(this->db_, this->sql_.identity_by_name.c_str());
+    if (!stmt)
+        return -1;
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_STATIC);
+
+    int64_t identity_id = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        identity_id = sqlite3_column_int64(stmt, 0);
+    }
+    else
+    {
+        LOGE("获取身份失败: " << sqlite3_errmsg(this->db_));
+    }
+    return identity_id;
+}
+
+// 替换表名占位符
+template <typename Traits>
+std::string SqliteFaceDatabase<Traits>::expand(const char *sql)
+{
+    std::string result = sql;
+    const std::pair<const char *, const char *> tables[] = {
+        {"{faces}", Traits::faces_table},
+        {"{identities}", Traits::identities_table},
+    };
+    for (const auto &[placeholder, table] : tables)
+    {
+        size_t length = strlen(placeholder);
+        for (size_t pos = result.find(placeholder); pos != std::string::npos; pos = result.find(placeholder, pos + strlen(table)))
+        {
+            result.replace(pos, length, table);
+        }
+    }
+    return result;
+}
+
+template class SqliteFaceDatabase<InspireFaceTraits>;
+template class SqliteFaceDatabase<OpencvFaceTraits>;
+template class SqliteFaceDatabase<DlibFaceTraits>;
@@ -0,0 +1,157 @@
+#pragma once
+#include <sqlite3.h>
+#include "common.h"
+#include "FaceDatabase.h"
+#include "EmbeddingBlob.h"
+#include "StatementCache.h"
+#include "ReadConnectionPool.h"
+
+// 各后端的参数：人脸表、身份表的表名和新写入特征的存储格式
+// 变更日志表、姓名索引和元数据 key 都以人脸表名为前缀；特征维度由模型决定，由人脸库记录在元数据中
+struct InspireFaceTraits
+{
+    static constexpr const char *faces_table = "inspire_faces";
+    static constexpr const char *identities_table = "inspire_identities";
+    static constexpr const char *dtype = DATABASE_EMBEDDING_DTYPE;
+};
+
+struct OpencvFaceTraits
+{
+    static constexpr const char *faces_table = "opencv_faces";
+    static constexpr const char *identities_table = "opencv_identities";
+    static constexpr const char *dtype = DATABASE_EMBEDDING_DTYPE;
+};
+
+struct DlibFaceTraits
+{
+    static constexpr const char *faces_table = "faces";
+    static constexpr const char *identities_table = "identities";
+    static constexpr const char *dtype = DATABASE_EMBEDDING_DTYPE;
+};
+
+// 三个后端共用的 SQLite 人脸数据库，按 Traits 区分表名和特征格式
+// 一个写连接（dbMutex_ 保护）负责写入和变更日志，查询使用只读连接池；语句按表名展开后只编译一次
+template <typename Traits>
+class SqliteFaceDatabase : public FaceDatabase
+{
+public:
+    // read_connections 为只读连接数，0 表示查询也使用写连接
+    SqliteFaceDatabase(const std::string &db_path, size_t read_connections = DATABASE_READ_CONNECTIONS);
+    ~SqliteFaceDatabase();
+
+    // 初始化表结构
+    bool init_table() override;
+
+    // 存储人脸数据
+    int64_t insert(const Facedata &face, const std::string &img_path) override;
+
+    // 批量插入，每 DATABASE_BATCH_ROWS 行一个事务
+    int64_t insert_batch(std::vector<Facedata> &faces, const std::vector<std::string> &img_paths) override;
+
+    // 预留 count 个连续的人脸 id，返回第一个
+    int64_t reserve_ids(size_t count) override;
+
+    // 预留 count 个连续的身份 id，返回第一个
+    int64_t reserve_identity_ids(size_t count) override;
+
+    // 读取全部身份
+    bool load_identities(std::vector<std::pair<int64_t, std::string>> &identities) override;
+
+    // 按预先分配的 id 和身份写入，id 已存在的跳过
+    int64_t insert_journaled(std::vector<Facedata> &faces, const std::vector<std::string> &img_paths) override;
+
+    // 查询数据库人脸数量
+    int64_t get_face_count() override;
+
+    // 根据名称查找人脸数据
+    std::vector<Facedata> find_by_name(const std::string &name) override;
+
+    // 根据名称查找全部人脸 id
+    std::vector<int64_t> find_ids_by_name(const std::string &name) override;
+
+    // 根据ID查找人脸数据
+    std::vector<Facedata> find_by_id(int id) override;
+
+    // 获取所有已知人脸数据（用于程序启动时加载到内存）
+    std::vector<Facedata> load_all_faces() override;
+
+    // 流式加载全部人脸到连续特征区
+    bool load_arena(FaceArena &arena) override;
+
+    // 根据名称删除该姓名的全部人脸数据，返回被删除的 id
+    std::vector<int64_t> delete_by_name(const std::string &name) override;
+
+    // 根据ID删除人脸数据
+    int64_t delete_by_id(int id) override;
+
+    // 当前变更序号
+    int64_t change_sequence() override;
+
+    // 序号大于 sequence 的变更涉及的人脸 id 和身份 id
+    bool changes_since(int64_t sequence, std::vector<int64_t> &face_ids, std::vector<int64_t> &identity_ids) override;
+
+    // 删除序号不大于 sequence 的变更
+    bool prune_changes(int64_t sequence) override;
+
+    // 其他连接的写入计数
+    int64_t data_version() override;
+
+    // 读取元数据
+    std::string get_meta(const std::string &key) override;
+
+    // 写入元数据
+    bool set_meta(const std::string &key, const std::string &value) override;
+
+private:
+    // 按表名展开的 SQL，构造时生成一次；语句缓存以 SQL 文本为键
+    struct Sql
+    {
+        std::string count;
+        std::string insert;
+        std::string seed_sequence;
+        std::string reserve_ids;
+        std::string seed_identity_sequence;
+        std::string reserve_identity_ids;
+        std::string select_identities;
+        std::string identity_by_name;
+        std::string insert_identity;
+        std::string insert_identity_with_id;
+        std::string insert_with_id;
+        std::string select_all;
+        std::string select_arena;
+        std::string select_by_name;
+        std::string select_by_id;
+        std::string ids_by_name;
+        std::string delete_by_name;
+        std::string delete_by_id;
+        std::string change_sequence;
+        std::string oldest_change;
+        std::string changes_since;
+        std::string prune_changes;
+    };
+
+    // 把 sql 中的 {faces}、{identities} 替换为本后端的表名
+    static std::string expand(const char *sql);
+
+    // 先补上 seed 表的序列号记录，再执行 reserve 把序列号推后 count，返回预留的第一个 id；调用方需持有 dbMutex_
+    int64_t reserve_sequence_locked(const std::string &seed, const std::string &reserve, size_t count);
+
+    // 按姓名获取身份 id，不存在时创建；调用方需持有 dbMutex_
+    int64_t identity_id_locked(const std::string &name);
+
+    // 插入一行，调用方需持有 dbMutex_；identity_out 不为空时写回身份 id
+    int64_t insert_locked(const Facedata &face, const std::string &img_path, int64_t *identity_out);
+
+    sqlite3 *db_;
+    std::string databastpath_;
+    Sql sql_;
+    std::string meta_prefix_;       // 元数据 key 前缀：人脸表名 + "."
+    EmbeddingBlob::Dtype dtype_;    // 新写入特征的存储格式
+    StatementCache statements_;     // 预编译语句，在 dbMutex_ 下使用
+    mutable std::mutex dbMutex_;
+    ReadConnectionPool readers_; // 查询使用的只读连接，WAL 模式下与写连接并发
+};
+
+using InspireFaceDatabase = SqliteFaceDatabase<InspireFaceTraits>;
+using OpencvFaceDatabase = SqliteFaceDatabase<OpencvFaceTraits>;
+using DlibFaceDatabase = SqliteFaceDatabase<DlibFaceTraits>;
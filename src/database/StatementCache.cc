@@ -0,0 +1,46 @@
+#include "StatementCache.h"
+
+CachedStatement::~CachedStatement()
+{
+    if (this->stmt_)
+    {
+        sqlite3_reset(this->stmt_);
+        sqlite3_clear_bindings(this->stmt_);
+    }
+}
+
+StatementCache::~StatementCache()
+{
+    this->clear();
+}
+
+CachedStatement StatementCache::prepare(sqlite3 *db, const char *sql)
+{
+    auto it = this->statements_.find(std::string_view(sql));
+    if (it != this->statements_.end())
+    {
+        return CachedStatement(it->second);
+    }
+
+    // 长期复用的语句，提示 SQLite 不要从 lookaside 内存池分配
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOGE("SQL 编译失败: " << sqlite3_errmsg(db));
+        sqlite3_finalize(stmt);
+        return CachedStatement(nullptr);
+    }
+    this->texts_.emplace_back(sql);
+    this->statements_.emplace(this->texts_.back(), stmt);
+    return CachedStatement(stmt);
+}
+
+void StatementCache::clear()
+{
+    for (auto &[sql, stmt] : this->statements_)
+    {
+        sqlite3_finalize(stmt);
+    }
+    this->statements_.clear();
+    this->texts_.clear();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <sqlite3.h>
+#include "common.h"
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+
+// 从缓存取出的预编译语句，析构时 reset 并清空绑定，供下一次调用复用
+// 可隐式转换为 sqlite3_stmt*，直接传给 sqlite3_bind_* / sqlite3_step / sqlite3_column_*
+class CachedStatement
+{
+public:
+    explicit CachedStatement(sqlite3_stmt *stmt) : stmt_(stmt) {}
+    CachedStatement(const CachedStatement &) = delete;
+    CachedStatement &operator=(const CachedStatement &) = delete;
+    ~CachedStatement();
+
+    operator sqlite3_stmt *() const { return this->stmt_; }
+
+private:
+    sqlite3_stmt *stmt_;
+};
+
+// 每个数据库连接一份的预编译语句缓存：同一条 SQL 只编译一次，之后 reset 复用
+// 不加锁，由持有连接的数据库类在 dbMutex_ 下使用；同一条语句不能嵌套取出
+class StatementCache
+{
+public:
+    StatementCache() = default;
+    StatementCache(const StatementCache &) = delete;
+    StatementCache &operator=(const StatementCache &) = delete;
+    ~StatementCache();
+
+    // 取出 sql 对应的语句，首次使用时编译；编译失败时返回的语句为空
+    CachedStatement prepare(sqlite3 *db, const char *sql);
+
+    // 销毁全部语句，关闭连接前必须调用
+    void clear();
+
+private:
+    // 以 SQL 文本查找，键指向 texts_ 中保存的副本，查找时不构造 std::string
+    std::unordered_map<std::string_view, sqlite3_stmt *> statements_;
+    std::deque<std::string> texts_; // 追加不移动已有元素，键始终有效
+};
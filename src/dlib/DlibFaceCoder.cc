@@ -164,6 +164,15 @@ std::vector<Facedata> DlibFaceCoder::get_facedatas(const cv::Mat& cv_img)
     return face_datas;
 }
 
+// 当前模型输出的特征向量维度，用一张空白的对齐人脸跑一次网络得到
+int DlibFaceCoder::feature_length()
+{
+    matrix<rgb_pixel> blank(150, 150);
+    assign_all_pixels(blank, rgb_pixel(0, 0, 0));
+    matrix<float, 0, 1> encoding = this->net_(blank);
+    return static_cast<int>(encoding.size());
+}
+
 // 已有人脸库与单个人脸进行比较，判断是否匹配 (默认阈值0.6),输入图片中可能有多张人脸，多个人脸全部匹配成功才返回True
 double DlibFaceCoder::compareFeatures(const Facedata& face1, const Facedata& face2)
 {
@@ -30,6 +30,9 @@ public:
     // 从图像文件获取所有人脸数据
     std::vector<Facedata> get_facedatas(const cv::Mat& cv_img);
 
+    // 当前模型输出的特征向量维度
+    int feature_length();
+
     // 比较人脸编码,已有的人脸库对比单个人脸编码
     double compareFeatures(const Facedata& face1, const Facedata& face2);
 
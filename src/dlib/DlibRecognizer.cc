@@ -6,50 +6,38 @@ DlibRecognizer::DlibRecognizer(const std::string &dbPath,
 {
 
     this->facedatabase_ = FaceDatabase::create(dbPath, DLIB);
+    // 重放上次退出前未写入数据库的注册，须在加载人脸库之前
+    this->journal_ = FaceJournal::create(this->facedatabase_.get(), dbPath + ".dlib" DATABASE_JOURNAL_SUFFIX);
     this->facecoder_ = DlibFaceCoder::create(detectorPath, recognizerPath);
 
-    std::vector<Facedata> facedatas = facedatabase_->load_all_faces();
-
-    // 1. 定义度量
-    metric_punned_t metric(128, metric_kind_t::l2sq_k, scalar_kind_t::f32_k);
-
-    // 2. 定义配置 (可选，但建议显式指定)
-    index_dense_config_t config;
-    // config.connectivity = 16; // 默认 M=16，增加此值可提高精度但增加内存
-
-    // 3. 初始化索引
-    this->index_ = index_dense_t::make(metric, config);
-
-    // 4. 预留空间（提升性能）
-    this->index_.reserve(facedatas.size());
-
-    // 5. 循环添加数据
-    for (const Facedata &face : facedatas)
-    {
-        // 1. 加入向量索引
-        // 注意：这里的 face.id 必须是正整数 (uint64_t)
-        this->index_.add(face.id, face.embedding.data());
-
-        //  额外存一个 ID 到数据的映射，方便搜索后直接取出结构体
-        this->facedata_map_[face.id] = face;
-    }
+    // 加载人脸库，特征维度由当前模型决定，索引快照有效时直接载入，否则从数据库重建
+    this->gallery_ = FaceGallery::create(this->facedatabase_.get(),
+                                         dbPath + ".dlib" GALLERY_SNAPSHOT_SUFFIX,
+                                         this->facecoder_->feature_length(),
+                                         metric_kind_t::l2sq_k);
+    this->gallery_->set_journal(this->journal_.get());
 }
 
 // 查询数据库人脸数据数量
 int DlibRecognizer::getFacedatabaseCount()
 {
+    if (!this->journal_->flush())
+    {
+        LOGE("有注册尚未写入数据库，无法统计人脸数量");
+        return -1;
+    }
     return this->facedatabase_->get_face_count();
 }
 
 // 注册人脸,cv::Mat 版本
 bool DlibRecognizer::registerFace(const cv::Mat &image, const std::string &name)
 {
-    std::string registered_name = name;
     // 检测人脸库里面是否有这个人脸，这里做特征向量匹配
+    // 同名的人脸作为该身份的一张新模板注册，只拒绝已属于其他人的人脸
     std::vector<Facedata> list = this->recognizeFace(image);
     for (const auto &face : list)
     {
-        if (face.name != "unknown")
+        if (face.name != "unknown" && face.name != name)
         {
             LOGE("已存在此人脸，请勿重复注册，名字:" << face.name);
             return false;
@@ -69,33 +57,22 @@ bool DlibRecognizer::registerFace(const cv::Mat &image, const std::string &name)
         return false;
     }
 
-    // 判断这个人脸的名字是否存在
-    auto existing_faces = this->facedatabase_->find_by_name(name);
-    int count = existing_faces.size();
-    if (count > 0)
-    {
-        registered_name += std::to_string(count);
-        LOGW("名称:" << name << "已存在，注册为新名称: " << registered_name);
-    }
-
     // 开始注册操作
     Facedata &newFace = newFaces[0];
-    newFace.name = registered_name;
+    newFace.name = name; // 同名即同一身份
 
-    // 插入到数据库
-    uint64_t id = this->facedatabase_->insert(newFace, ""); // img_path 可选，这里传空字符串
-    if (-1 != id)
+    // 先分配 id 和身份加入内存人脸库，立即可检索；数据库写入由写后日志在后台完成
+    if (!this->journal_->reserve(newFace))
     {
-        // 同时添加到内存中的人脸数据
-        this->facedata_map_[id] = newFace;
-        this->index_.add(id, newFace.embedding.data());
+        LOGW("insert face failed");
+        return false;
     }
-    else
+    if (!this->gallery_->add(newFace))
     {
-        LOGW("insert face failed");
+        this->journal_->release(newFace.id);
         return false;
     }
-    return true;
+    return this->journal_->append(newFace, "");
 }
 
 // 注册人脸， 图像路径版本
@@ -103,7 +80,6 @@ bool DlibRecognizer::registerFace(const std::string path, const std::string &nam
 {
 
     cv::Mat image = cv::imread(path);
-    std::string registered_name = name;
     // 判空
     if (image.empty())
     {
@@ -112,10 +88,11 @@ bool DlibRecognizer::registerFace(const std::string path, const std::string &nam
     }
 
     // 检测人脸库里面是否有这个人脸，这里做特征向量匹配
+    // 同名的人脸作为该身份的一张新模板注册，只拒绝已属于其他人的人脸
     std::vector<Facedata> list = this->recognizeFace(image);
     for (const auto &face : list)
     {
-        if (face.name != "unknown")
+        if (face.name != "unknown" && face.name != name)
         {
             LOGE("已存在此人脸，请勿重复注册，名字:" << face.name);
             return false;
@@ -135,112 +112,110 @@ bool DlibRecognizer::registerFace(const std::string path, const std::string &nam
         return false;
     }
 
-    // 判断这个人脸的名字是否存在
-    auto existing_faces = this->facedatabase_->find_by_name(name);
-    int count = existing_faces.size();
-    if (count > 0)
-    {
-        registered_name += std::to_string(count);
-        LOGW("名称:" << name << "已存在，注册为新名称: " << registered_name);
-    }
-
     // 开始注册操作
     Facedata &newFace = newFaces[0];
-    newFace.name = registered_name;
+    newFace.name = name; // 同名即同一身份
 
-    // 插入到数据库
-    uint64_t id = this->facedatabase_->insert(newFace, path);
-    if (-1 != id)
+    // 先分配 id 和身份加入内存人脸库，立即可检索；数据库写入由写后日志在后台完成
+    if (!this->journal_->reserve(newFace))
     {
-        // 同时添加到内存中的人脸数据
-        this->facedata_map_[id] = newFace;
-        this->index_.add(id, newFace.embedding.data());
+        LOGW("insert face failed");
+        return false;
     }
-    else
+    if (!this->gallery_->add(newFace))
     {
-        LOGW("insert face failed");
+        this->journal_->release(newFace.id);
         return false;
     }
-    return true;
+    return this->journal_->append(newFace, path);
+}
+
+// 批量注册：编码器不支持并发推理，推理串行执行，与其他线程的读图解码重叠
+std::vector<int64_t> DlibRecognizer::registerFaces(const std::vector<FaceEnrollment> &batch)
+{
+    std::mutex coderMutex;
+    return this->gallery_->enroll_batch(
+        batch,
+        [&](const std::string &path)
+        {
+            cv::Mat image = cv::imread(path);
+            if (image.empty())
+            {
+                LOGE("无法读取图像文件: " << path);
+                return std::vector<Facedata>();
+            }
+            std::lock_guard<std::mutex> lock(coderMutex);
+            return this->facecoder_->get_facedatas(image);
+        },
+        // 索引返回的是欧氏距离的平方
+        [this](float distance)
+        { return std::sqrt(distance) <= this->tolerance_; });
 }
 
 // 在人脸库查找此人脸特征，返回对应人脸结构体
 std::vector<Facedata> DlibRecognizer::recognizeFace(const cv::Mat &faceImage)
 {
-    std::vector<Facedata> queryFaces = this->facecoder_->get_facedatas(faceImage);
-
-    if (queryFaces.empty())
+    // 只取最佳候选
+    std::vector<FaceRecognition> results = this->recognizeTopK(faceImage, 1);
+    std::vector<Facedata> faces;
+    faces.reserve(results.size());
+    for (FaceRecognition &result : results)
     {
-        // LOGE("未检测到人脸，识别失败");
-        return queryFaces;
+        faces.push_back(std::move(result.face));
     }
-    // 当前人脸查找方式（使用向量索引查找）
-    for (auto &queryFace : queryFaces)
-    {
-        if (this->index_.size() <= 0)
-        {
-            return queryFaces;
-        }
-        auto results = this->index_.search(queryFace.embedding.data(), 3);
-
-        for (size_t i = 0; i < results.size(); ++i)
-        {
-            uint64_t found_id = results[i].member.key; // 之前 add 进去的 ID
-            float distance = std::sqrt(results[i].distance); // 余弦距离
+    return faces;
+}
 
-            if (distance <= this->tolerance_)
-            {
-                Facedata match = this->facedata_map_[found_id];
-                queryFace.id = match.id;
-                queryFace.name = match.name;
-                queryFace.score = distance;
-                // std::cout << "识别成功！姓名: " << match.name << "，距离: " << distance << std::endl;
-            }
-        }
+// 在人脸库查找每张人脸最相近的 k 个身份，一次批量检索得到全部候选
+std::vector<FaceRecognition> DlibRecognizer::recognizeTopK(const cv::Mat &faceImage, size_t k)
+{
+    std::vector<Facedata> queryFaces = this->facecoder_->get_facedatas(faceImage);
+    std::vector<FaceRecognition> results(queryFaces.size());
+    for (size_t f = 0; f < queryFaces.size(); ++f)
+    {
+        results[f].face = std::move(queryFaces[f]);
     }
 
-    // 原本的查找方式(一个个遍历计算欧氏距离)
-    // for (auto &queryFace : queryFaces)
-    // {
-    //     for (const auto &[_, dbFace] : this->facedata_map_)
-    //     {
-    //         double distance = facecoder_->compareFeatures(queryFace, dbFace);
-    //         // 如果两个人脸的欧氏距离小于阈值，认为是同一人
-    //         if (distance <= this->tolerance_)
-    //         {
-    //             // 更新查询人脸的信息为匹配到的数据库人脸
-    //             queryFace.id = dbFace.id;
-    //             queryFace.name = dbFace.name;
-    //             queryFace.score = distance;
-    //             break;
-    //         }
-    //     }
-    // }
-    return queryFaces;
+    // 索引返回的是欧氏距离的平方
+    this->gallery_->recognize(results, k, [this](float squared)
+                              {
+                                  float distance = std::sqrt(squared);
+                                  return GalleryScore{1.0f - distance, distance, distance <= this->tolerance_}; });
+    return results;
 }
 
 // 查找人脸数据
 std::vector<Facedata> DlibRecognizer::findByNname(const std::string &name)
 {
+    // 等待排队的注册写入数据库，读到刚注册的人脸
+    if (!this->journal_->flush())
+    {
+        LOGE("有注册尚未写入数据库，无法按姓名查找: " << name);
+        return {};
+    }
     return this->facedatabase_->find_by_name(name);
 }
 
 // 删除人脸数据
 bool DlibRecognizer::deleteFaceByName(const std::string &name)
 {
-    // 从数据库删除
-    uint64_t id = facedatabase_->delete_by_name(name);
-    if (-1 != id)
+    // 排队的注册先写入数据库，否则删除之后又会被写回
+    if (!this->journal_->flush())
     {
-        // 同时从内存中删除
-        this->facedata_map_.erase(id);
-        this->index_.remove(id);
+        LOGE("有注册尚未写入数据库，暂不能删除: " << name);
+        return false;
     }
-    else
+
+    // 从数据库删除该姓名的全部人脸
+    std::vector<int64_t> ids = facedatabase_->delete_by_name(name);
+    if (ids.empty())
     {
         LOGE("删除人脸失败: {}" << name);
         return false;
     }
+
+    // 同时从内存中删除，整批发布一个版本
+    this->gallery_->remove(std::vector<uint64_t>(ids.begin(), ids.end()));
     return true;
 }
 
@@ -259,6 +234,16 @@ bool DlibRecognizer::setThreshold(double threshold)
     return threshold == this->tolerance_;
 }
 
+// 设置人脸库 HNSW 索引参数
+bool DlibRecognizer::setIndexParams(size_t connectivity, size_t expansion_add, size_t expansion_search)
+{
+    GalleryIndexParams params;
+    params.connectivity = connectivity;
+    params.expansion_add = expansion_add;
+    params.expansion_search = expansion_search;
+    return this->gallery_->set_index_params(params);
+}
+
 // 获取当前使用的后端名称
 std::string DlibRecognizer::getBackendName() const
 {
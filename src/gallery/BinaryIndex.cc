@@ -0,0 +1,170 @@
+#include "BinaryIndex.h"
+#include <algorithm>
+
+namespace
+{
+    // 两组签名的汉明距离
+    using hamming_fn = uint32_t (*)(const uint64_t *a, const uint64_t *b, size_t words);
+
+    uint32_t hamming_scalar(const uint64_t *a, const uint64_t *b, size_t words)
+    {
+        uint32_t distance = 0;
+        for (size_t i = 0; i < words; ++i)
+        {
+            uint64_t x = a[i] ^ b[i];
+            // SWAR 计数，不依赖 popcnt 指令
+            x = x - ((x >> 1) & 0x5555555555555555ULL);
+            x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+            x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+            distance += static_cast<uint32_t>((x * 0x0101010101010101ULL) >> 56);
+        }
+        return distance;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("popcnt"))) uint32_t hamming_popcnt(const uint64_t *a, const uint64_t *b, size_t words)
+    {
+        uint32_t distance = 0;
+        for (size_t i = 0; i < words; ++i)
+        {
+            distance += static_cast<uint32_t>(__builtin_popcountll(a[i] ^ b[i]));
+        }
+        return distance;
+    }
+#endif
+
+    // 按 CPU 特性选择实现，只在第一次使用时检测
+    struct HammingKernel
+    {
+        hamming_fn fn = hamming_scalar;
+        const char *name = "scalar";
+
+        HammingKernel()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("popcnt"))
+            {
+                fn = hamming_popcnt;
+                name = "popcnt";
+            }
+#endif
+        }
+    };
+
+    const HammingKernel &kernel()
+    {
+        static const HammingKernel instance;
+        return instance;
+    }
+
+    constexpr size_t kBlockRows = GALLERY_BINARY_BLOCK_ROWS;
+}
+
+BinaryIndex::BinaryIndex(size_t dimensions)
+    : dimensions_(dimensions),
+      words_((dimensions + 63) / 64),
+      blocks_(GALLERY_BINARY_MAX_BLOCKS)
+{
+}
+
+const char *BinaryIndex::isa_name()
+{
+    return kernel().name;
+}
+
+size_t BinaryIndex::size() const
+{
+    return this->rows_.load(std::memory_order_acquire);
+}
+
+size_t BinaryIndex::memory_usage() const
+{
+    size_t blocks = (this->size() + kBlockRows - 1) / kBlockRows;
+    return blocks * kBlockRows * (this->words_ + 1) * sizeof(uint64_t);
+}
+
+// 第 d 维为正时置位
+void BinaryIndex::signature(const float *embedding, uint64_t *out) const
+{
+    std::fill(out, out + this->words_, 0);
+    for (size_t d = 0; d < this->dimensions_; ++d)
+    {
+        out[d / 64] |= static_cast<uint64_t>(embedding[d] > 0.f) << (d % 64);
+    }
+}
+
+// 追加：先写入行数据，再发布行数
+bool BinaryIndex::add(uint64_t key, const float *embedding)
+{
+    size_t row = this->rows_.load(std::memory_order_relaxed);
+    size_t block = row / kBlockRows;
+    if (block >= this->blocks_.size())
+    {
+        LOGE("签名索引已满: " << row);
+        return false;
+    }
+    if (!this->blocks_[block])
+    {
+        std::unique_ptr<Block> created = std::make_unique<Block>();
+        created->signatures = std::make_unique<uint64_t[]>(kBlockRows * this->words_);
+        created->keys = std::make_unique<uint64_t[]>(kBlockRows);
+        this->blocks_[block] = std::move(created);
+    }
+
+    Block &target = *this->blocks_[block];
+    size_t offset = row % kBlockRows;
+    this->signature(embedding, target.signatures.get() + offset * this->words_);
+    target.keys[offset] = key;
+    this->rows_.store(row + 1, std::memory_order_release);
+    return true;
+}
+
+// 线性扫描，用大小为 k 的最大堆保留距离最小的行
+size_t BinaryIndex::search(const float *query, size_t k, GalleryMatch *out) const
+{
+    size_t rows = this->size();
+    if (rows == 0 || k == 0)
+    {
+        return 0;
+    }
+
+    // 缓冲区线程局部复用
+    thread_local std::vector<uint64_t> query_signature;
+    thread_local std::vector<std::pair<uint32_t, size_t>> heap;
+    query_signature.resize(this->words_);
+    this->signature(query, query_signature.data());
+    heap.clear();
+
+    hamming_fn hamming = kernel().fn;
+    const uint64_t *q = query_signature.data();
+    for (size_t block = 0; block * kBlockRows < rows; ++block)
+    {
+        const uint64_t *signatures = this->blocks_[block]->signatures.get();
+        size_t count = std::min(kBlockRows, rows - block * kBlockRows);
+        for (size_t offset = 0; offset < count; ++offset)
+        {
+            uint32_t distance = hamming(signatures + offset * this->words_, q, this->words_);
+            if (heap.size() < k)
+            {
+                heap.emplace_back(distance, block * kBlockRows + offset);
+                std::push_heap(heap.begin(), heap.end());
+            }
+            else if (distance < heap.front().first)
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = {distance, block * kBlockRows + offset};
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    for (size_t i = 0; i < heap.size(); ++i)
+    {
+        size_t row = heap[i].second;
+        out[i].id = this->blocks_[row / kBlockRows]->keys[row % kBlockRows];
+        out[i].distance = static_cast<float>(heap[i].first);
+    }
+    return heap.size();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "common.h"
+#include "config.h"
+#include "GalleryTypes.h"
+#include <atomic>
+
+// 符号位签名索引：每个特征按维度取符号位压成 uint64 字（512 维 = 8 个字 = 64 字节，只有 f32 的 1/32），
+// 检索时用 popcount 计算汉明距离线性扫描，得到的候选由调用方用 f32 特征精排
+// 只追加：删除由调用方按当前版本过滤，压缩时重建。行按块存放，块表在构造时定长分配，已发布的行不会移动，
+// 所以一个写者追加与多个读者检索可以并发（读者只扫描 size() 之前的行）
+class BinaryIndex
+{
+public:
+    explicit BinaryIndex(size_t dimensions);
+    BinaryIndex(const BinaryIndex &) = delete;
+    BinaryIndex &operator=(const BinaryIndex &) = delete;
+
+    // 追加一行，超过容量上限返回 false；只允许一个写者
+    bool add(uint64_t key, const float *embedding);
+
+    // 检索汉明距离最小的 k 行写入 out（distance 为汉明距离），按距离升序，返回结果数
+    size_t search(const float *query, size_t k, GalleryMatch *out) const;
+
+    // 已追加的行数（含已被调用方删除的行）
+    size_t size() const;
+
+    size_t memory_usage() const;
+
+    // 运行时选中的 popcount 实现（popcnt / scalar）
+    static const char *isa_name();
+
+private:
+    // 一块连续的行：签名按行存放，每行 words_ 个字
+    struct Block
+    {
+        std::unique_ptr<uint64_t[]> signatures;
+        std::unique_ptr<uint64_t[]> keys;
+    };
+
+    // 计算特征的签名
+    void signature(const float *embedding, uint64_t *out) const;
+
+    size_t dimensions_;
+    size_t words_; // 每行的 uint64 字数
+    std::vector<std::unique_ptr<Block>> blocks_; // 定长块表，按需分配块
+    std::atomic<size_t> rows_{0};
+};
@@ -0,0 +1,202 @@
+#include "DuplicateFinder.h"
+#include "ShardedIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
+namespace
+{
+    // 跨身份的近邻对
+    struct DuplicatePair
+    {
+        int identity_a;
+        int identity_b;
+        int face_a;
+        int face_b;
+        float distance;
+    };
+
+    // 并查集（路径压缩）
+    size_t find_root(std::vector<size_t> &parent, size_t x)
+    {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+}
+
+// 检索进度（在 lambda 外输出，日志中显示函数名）
+static void join_progress(size_t done, size_t total)
+{
+    LOGI("近邻检索进度: " << done << "/" << total << " (" << done * 100 / total << "%)");
+}
+
+DuplicateFinder::DuplicateFinder(metric_kind_t metric, size_t neighbors, size_t threads)
+    : metric_(metric),
+      neighbors_(std::max<size_t>(neighbors, 1)),
+      pool_(threads)
+{
+}
+
+// 重复身份检测
+std::vector<DuplicateCluster> DuplicateFinder::find(const std::vector<Facedata> &faces, float max_distance)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // 只处理有身份、维度一致的人脸
+    std::vector<const Facedata *> rows;
+    rows.reserve(faces.size());
+    for (const Facedata &face : faces)
+    {
+        if (face.identity_id >= 0 && !face.embedding.empty() &&
+            (rows.empty() || face.embedding.size() == rows.front()->embedding.size()))
+        {
+            rows.push_back(&face);
+        }
+    }
+    if (rows.size() < 2)
+    {
+        return {};
+    }
+    size_t dimensions = rows.front()->embedding.size();
+
+    // 以行号为 key 并行建索引
+    std::vector<std::pair<uint64_t, const float *>> entries;
+    entries.reserve(rows.size());
+    for (size_t row = 0; row < rows.size(); ++row)
+    {
+        entries.emplace_back(row, rows[row]->embedding.data());
+    }
+    metric_punned_t metric(dimensions, this->metric_, scalar_kind_t::f32_k);
+    size_t shards = ShardedIndex::auto_shard_count(rows.size());
+    ShardedIndex index(metric, index_dense_config_t(GALLERY_CONNECTIVITY, GALLERY_EXPANSION_ADD, GALLERY_EXPANSION_SEARCH),
+                       shards, this->pool_.size());
+    index.reserve(rows.size() / shards + rows.size() / (shards * 8) + 1);
+    index.build(entries, this->pool_);
+
+    // 每张人脸检索 neighbors + 1 个近邻（含自身），分批并行；每个线程把结果写入自己的列表
+    size_t wanted = this->neighbors_ + 1;
+    size_t batches = (rows.size() + GALLERY_BUILD_BATCH - 1) / GALLERY_BUILD_BATCH;
+    size_t step = std::max<size_t>(rows.size() / 10, 1);
+    std::vector<std::vector<DuplicatePair>> found(this->pool_.size());
+    std::atomic<size_t> done{0};
+    this->pool_.parallel_for(batches, [&](size_t thread, size_t batch)
+                             {
+        std::vector<GalleryMatch> neighbors(wanted);
+        size_t begin = batch * GALLERY_BUILD_BATCH;
+        size_t end = std::min(begin + GALLERY_BUILD_BATCH, rows.size());
+        for (size_t row = begin; row < end; ++row)
+        {
+            const Facedata &face = *rows[row];
+            size_t count = index.search(face.embedding.data(), wanted, neighbors.data());
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Facedata &other = *rows[neighbors[i].id];
+                // 同一身份内的模板不算重复
+                if (neighbors[i].distance > max_distance || other.identity_id == face.identity_id)
+                {
+                    continue;
+                }
+                // HNSW 的 k 近邻不对称，两侧都记录，按身份 id 升序规范化后再去重
+                if (face.identity_id < other.identity_id)
+                {
+                    found[thread].push_back({face.identity_id, other.identity_id, face.id, other.id, neighbors[i].distance});
+                }
+                else
+                {
+                    found[thread].push_back({other.identity_id, face.identity_id, other.id, face.id, neighbors[i].distance});
+                }
+            }
+        }
+        size_t before = done.fetch_add(end - begin);
+        if (batches >= 10 && before / step != (before + end - begin) / step)
+        {
+            join_progress(before + end - begin, rows.size());
+        } });
+
+    // 身份编号压缩到 [0, n) 后用并查集合并
+    std::unordered_map<int, size_t> slots;
+    std::vector<int> identity_ids;
+    std::vector<DuplicatePair> pairs;
+    for (auto &list : found)
+    {
+        pairs.insert(pairs.end(), list.begin(), list.end());
+    }
+
+    // 两侧互为近邻的一对会被记录两次，只保留一次
+    std::sort(pairs.begin(), pairs.end(), [](const DuplicatePair &a, const DuplicatePair &b)
+              { return std::tie(a.face_a, a.face_b, a.distance) < std::tie(b.face_a, b.face_b, b.distance); });
+    pairs.erase(std::unique(pairs.begin(), pairs.end(), [](const DuplicatePair &a, const DuplicatePair &b)
+                            { return a.face_a == b.face_a && a.face_b == b.face_b; }),
+                pairs.end());
+    for (const DuplicatePair &pair : pairs)
+    {
+        for (int identity_id : {pair.identity_a, pair.identity_b})
+        {
+            if (slots.emplace(identity_id, identity_ids.size()).second)
+            {
+                identity_ids.push_back(identity_id);
+            }
+        }
+    }
+    std::vector<size_t> parent;
+    parent.resize(identity_ids.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const DuplicatePair &pair : pairs)
+    {
+        size_t a = find_root(parent, slots[pair.identity_a]);
+        size_t b = find_root(parent, slots[pair.identity_b]);
+        if (a != b)
+        {
+            parent[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    // 按根节点归组，记录每个簇最相近的一对
+    std::map<size_t, DuplicateCluster> clusters;
+    for (size_t slot = 0; slot < identity_ids.size(); ++slot)
+    {
+        DuplicateCluster &cluster = clusters[find_root(parent, slot)];
+        cluster.identity_ids.push_back(identity_ids[slot]);
+    }
+    for (const DuplicatePair &pair : pairs)
+    {
+        DuplicateCluster &cluster = clusters[find_root(parent, slots[pair.identity_a])];
+        if (cluster.pairs++ == 0 || pair.distance < cluster.distance)
+        {
+            cluster.face_a = pair.face_a;
+            cluster.face_b = pair.face_b;
+            cluster.distance = pair.distance;
+        }
+    }
+
+    std::unordered_map<int, const std::string *> name_of;
+    for (const Facedata *row : rows)
+    {
+        name_of.emplace(row->identity_id, &row->name);
+    }
+    std::vector<DuplicateCluster> result;
+    result.reserve(clusters.size());
+    for (auto &[_, cluster] : clusters)
+    {
+        std::sort(cluster.identity_ids.begin(), cluster.identity_ids.end());
+        for (int identity_id : cluster.identity_ids)
+        {
+            cluster.names.push_back(*name_of[identity_id]);
+        }
+        result.push_back(std::move(cluster));
+    }
+    std::sort(result.begin(), result.end(), [](const DuplicateCluster &a, const DuplicateCluster &b)
+              { return a.distance < b.distance; });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOGI("重复身份检测完成: " << rows.size() << " faces, " << pairs.size() << " pairs, "
+                               << result.size() << " clusters, " << this->pool_.size() << " threads, " << elapsed << " ms");
+    return result;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "common.h"
+#include "config.h"
+#include "ThreadPool.h"
+#include "usearch/index_plugins.hpp"
+
+using namespace unum::usearch;
+
+// 疑似重复身份：距离不超过阈值的跨身份模板对，按并查集合并成簇
+struct DuplicateCluster
+{
+    std::vector<int> identity_ids;  // 簇中的身份，按 id 升序
+    std::vector<std::string> names; // 与 identity_ids 一一对应
+    int face_a = -1;                // 簇内最相近的一对模板
+    int face_b = -1;
+    float distance = 0.f;           // 这一对的距离，含义同 GalleryMatch::distance
+    size_t pairs = 0;               // 簇内超过阈值的模板对数
+};
+
+// 离线重复身份检测：全部人脸建 HNSW 索引（并行），每张人脸并行做 k 近邻检索，
+// 得到近似的全对相似度连接；复杂度约 O(n log n)，百万级人脸在单机数分钟内完成
+class DuplicateFinder
+{
+public:
+    // neighbors 为每张人脸检查的近邻数，threads 为 0 时使用 CPU 核数
+    DuplicateFinder(metric_kind_t metric, size_t neighbors = GALLERY_DEDUP_NEIGHBORS, size_t threads = 0);
+
+    // faces 需带 identity_id；max_distance 为判定重复的距离阈值（cos 为 1 - 相似度，l2sq 为欧氏距离的平方）
+    // 返回的簇按最相近一对的距离升序
+    std::vector<DuplicateCluster> find(const std::vector<Facedata> &faces, float max_distance);
+
+private:
+    metric_kind_t metric_;
+    size_t neighbors_;
+    ThreadPool pool_;
+};
@@ -0,0 +1,1939 @@
+#include "FaceGallery.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+// 人脸特征：注册时带入的特征在 Facedata 中（维度不一致时返回 nullptr），启动时批量加载的特征在连续特征区中
+static const float *face_embedding(const GalleryState &state, const GalleryFace &face)
+{
+    if (face.data && face.data->embedding.size() != state.dimensions)
+    {
+        return nullptr;
+    }
+    return face.embedding();
+}
+
+// 注册时带入的人脸，持有一份 Facedata
+static GalleryFace registered_face(const Facedata &face, int identity_id)
+{
+    std::shared_ptr<Facedata> data = std::make_shared<Facedata>(face);
+    data->identity_id = identity_id;
+    GalleryFace stored;
+    stored.id = face.id;
+    stored.identity_id = identity_id;
+    stored.data = std::move(data);
+    return stored;
+}
+
+// 身份质心：所有模板特征的均值
+static void compute_centroid(GalleryIdentity &identity, const GalleryState &state)
+{
+    size_t dimensions = state.dimensions;
+    identity.centroid.assign(dimensions, 0.f);
+    size_t count = 0;
+    for (uint64_t id : identity.templates)
+    {
+        const GalleryFace *face = state.faces.find(id);
+        const float *embedding = face == nullptr ? nullptr : face_embedding(state, *face);
+        if (embedding == nullptr)
+        {
+            continue;
+        }
+        for (size_t d = 0; d < dimensions; ++d)
+        {
+            identity.centroid[d] += embedding[d];
+        }
+        ++count;
+    }
+    if (count == 0)
+    {
+        identity.centroid.clear();
+        return;
+    }
+    for (float &x : identity.centroid)
+    {
+        x /= static_cast<float>(count);
+    }
+}
+
+// 两个特征是否相同，允许 f16 存储和量化带来的误差
+static bool same_embedding(const GalleryState &state, metric_kind_t metric, const float *a, const float *b)
+{
+    const byte_t *x = reinterpret_cast<const byte_t *>(a);
+    const byte_t *y = reinterpret_cast<const byte_t *>(b);
+    float scale = metric == metric_kind_t::cos_k ? 1.f : static_cast<float>(state.exact_metric(y, y) + 1.0);
+    return state.exact_metric(x, y) <= 1e-3 * scale;
+}
+
+// 在暴力检索矩阵的副本上修改后替换；内存不足时放弃暴力检索，由始终维护的 HNSW 接替
+static void edit_flat(GalleryState &next, const std::function<bool(FlatIndex &)> &edit)
+{
+    if (!next.flat)
+    {
+        return;
+    }
+    std::unique_ptr<FlatIndex> flat = next.flat->clone();
+    if (flat && edit(*flat))
+    {
+        next.flat = std::move(flat);
+        return;
+    }
+    LOGW("暴力检索矩阵更新失败，改用 HNSW 检索");
+    next.flat.reset();
+}
+
+// 进程的峰值常驻内存（MB），读取 /proc/self/status 的 VmHWM，不支持时返回 0
+static size_t peak_rss_mb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+        {
+            return std::stoul(line.substr(6)) / 1024;
+        }
+    }
+    return 0;
+}
+
+// 版本中的索引条目数
+static size_t entry_count(const GalleryState &state, bool centroid_mode)
+{
+    return centroid_mode ? state.identities.size() : state.faces.size();
+}
+
+FaceGallery::FaceGallery(FaceDatabase *facedatabase,
+                         const std::string &snapshot_path,
+                         size_t dimensions,
+                         metric_kind_t metric,
+                         const std::string &quantization,
+                         const GalleryIndexParams &params)
+    : facedatabase_(facedatabase),
+      snapshot_path_(snapshot_path),
+      dimensions_(dimensions),
+      metric_kind_(metric),
+      scalar_kind_(scalar_kind_t::f32_k),
+      params_(params),
+      pool_(std::make_unique<ThreadPool>(GALLERY_SEARCH_THREADS))
+{
+    expected_gt<scalar_kind_t> parsed = scalar_kind_from_name(quantization.c_str());
+    if (!parsed || (parsed.result != scalar_kind_t::f32_k &&
+                    parsed.result != scalar_kind_t::f16_k &&
+                    parsed.result != scalar_kind_t::i8_k))
+    {
+        LOGW("不支持的量化方式: " << quantization << "，使用 f32");
+        parsed.error.release();
+    }
+    else
+    {
+        this->scalar_kind_ = parsed.result;
+    }
+
+    // i8 量化会把每个向量缩放到单位长度，只对余弦度量成立
+    if (this->scalar_kind_ == scalar_kind_t::i8_k && this->metric_kind_ != metric_kind_t::cos_k)
+    {
+        LOGW("i8 量化仅适用于余弦度量，改用 f16");
+        this->scalar_kind_ = scalar_kind_t::f16_k;
+    }
+
+    std::string scoring = GALLERY_IDENTITY_SCORING;
+    if (scoring != "max" && scoring != "mean")
+    {
+        LOGW("不支持的身份聚合方式: " << scoring << "，使用 max");
+    }
+    this->mean_scoring_ = scoring == "mean";
+
+    // 签名索引按条目追加，质心更新后旧签名无法替换
+    if (this->binary_mode_ && this->centroid_mode_)
+    {
+        LOGW("签名预筛选不支持质心模式，使用 HNSW");
+        this->binary_mode_ = false;
+    }
+
+    // 初始版本为空库
+    std::unique_ptr<GalleryState> initial = std::make_unique<GalleryState>();
+    if (this->dimensions_ > 0)
+    {
+        this->init_index(*initial, this->dimensions_);
+    }
+    this->state_.store(initial.release());
+}
+
+// 按确定的维度创建空索引
+void FaceGallery::init_index(GalleryState &next, size_t dimensions)
+{
+    this->dimensions_ = dimensions;
+    this->metric_ = metric_punned_t(dimensions, this->metric_kind_, this->scalar_kind_);
+
+    next.dimensions = dimensions;
+    next.exact_metric = metric_punned_t(dimensions, this->metric_kind_, scalar_kind_t::f32_k);
+    next.index = this->make_index(ShardedIndex::auto_shard_count(0));
+    next.flat.reset();
+    next.binary = this->binary_mode_ ? std::make_shared<BinaryIndex>(dimensions) : nullptr;
+}
+
+// 建立签名索引
+std::shared_ptr<BinaryIndex> FaceGallery::make_binary(const GalleryState &state) const
+{
+    std::shared_ptr<BinaryIndex> binary = std::make_shared<BinaryIndex>(state.dimensions);
+    for (const auto &[key, vector] : this->collect_entries(state))
+    {
+        if (!binary->add(key, vector))
+        {
+            break;
+        }
+    }
+    return binary;
+}
+
+// 按当前参数创建索引
+std::shared_ptr<ShardedIndex> FaceGallery::make_index(size_t shards) const
+{
+    index_dense_config_t config(this->params_.connectivity, this->params_.expansion_add, this->params_.expansion_search);
+    return std::make_shared<ShardedIndex>(this->metric_, config, shards, this->index_threads());
+}
+
+// 每个同时检索的线程需要一个 usearch 线程上下文
+// 读者数受 RCU 槽位限制，再加上批量检索线程池和一个写者
+size_t FaceGallery::index_threads() const
+{
+    return GALLERY_MAX_READER_THREADS + this->pool_->size() + 1;
+}
+
+// 工厂方法
+std::unique_ptr<FaceGallery> FaceGallery::create(FaceDatabase *facedatabase,
+                                                 const std::string &snapshot_path,
+                                                 size_t dimensions,
+                                                 metric_kind_t metric,
+                                                 const std::string &quantization,
+                                                 const GalleryIndexParams &params)
+{
+    std::unique_ptr<FaceGallery> gallery = std::make_unique<FaceGallery>(facedatabase, snapshot_path, dimensions, metric, quantization, params);
+    gallery->load();
+    if (GALLERY_WATCH_INTERVAL_MS > 0)
+    {
+        gallery->watcher_ = std::thread(&FaceGallery::watch, gallery.get());
+    }
+    return gallery;
+}
+
+// 复制当前版本：人脸表和身份表只复制桶指针，之后修改哪个桶才复制哪个桶
+std::unique_ptr<GalleryState> FaceGallery::copy_state() const
+{
+    std::unique_ptr<GalleryState> next = std::make_unique<GalleryState>(*this->state_.load());
+    ++next->version;
+    return next;
+}
+
+// 发布新版本
+void FaceGallery::publish(std::unique_ptr<GalleryState> next)
+{
+    const GalleryState *old = this->state_.exchange(next.release());
+    if (old != nullptr)
+    {
+        RcuDomain::instance().retire([old]
+                                     { delete old; });
+    }
+    RcuDomain::instance().reclaim();
+}
+
+// 加载人脸库
+bool FaceGallery::load()
+{
+    std::unique_lock<std::mutex> lock(this->writeMutex_);
+    auto start = std::chrono::steady_clock::now();
+
+    // 在读取数据之前记下变更序号，读取期间其他进程的写入序号更大，之后会再同步一次
+    int64_t sequence = this->facedatabase_->change_sequence();
+
+    // 流式加载人脸数据库到连续特征区（姓名等信息始终以数据库为准），索引和人脸表都直接由特征区建立
+    std::shared_ptr<FaceArena> arena = std::make_shared<FaceArena>();
+    if (!this->facedatabase_->load_arena(*arena))
+    {
+        LOGE("加载人脸数据失败");
+        return false;
+    }
+    this->synced_sequence_ = std::max<int64_t>(sequence, 0);
+    auto read_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // 数据库与当前模型不匹配时拒绝加载，避免索引与 BLOB 维度不一致
+    if (!this->check_schema(arena->dimensions()))
+    {
+        this->valid_ = false;
+        return false;
+    }
+    if (this->dimensions_ == 0)
+    {
+        // 空库且无法从模型得到维度，等第一次注册时再确定
+        return true;
+    }
+
+    std::unique_ptr<GalleryState> next = std::make_unique<GalleryState>();
+    next->version = this->state_.load()->version + 1;
+    this->init_index(*next, this->dimensions_);
+    if (arena->dimensions() == this->dimensions_)
+    {
+        next->arena = arena;
+    }
+
+    // 按身份归组模板；人脸表只记录特征区中的行，姓名和特征都留在特征区中
+    // 人脸表和身份表整体建立一次，桶数按规模确定，之后的注册/删除只复制被修改的桶
+    std::unordered_map<uint64_t, GalleryIdentity> identities;
+    std::vector<std::pair<uint64_t, GalleryFace>> faces;
+    faces.reserve(next->arena ? arena->size() : 0);
+    for (size_t row = 0; next->arena && row < arena->size(); ++row)
+    {
+        int identity_id = arena->identity_id(row);
+        if (identity_id < 0)
+        {
+            LOGW("跳过没有身份的人脸, id: " << arena->id(row));
+            continue;
+        }
+        GalleryFace face;
+        face.id = arena->id(row);
+        face.identity_id = identity_id;
+        face.arena = arena.get();
+        face.row = static_cast<uint32_t>(row);
+        GalleryIdentity &identity = identities[identity_id];
+        if (identity.templates.empty())
+        {
+            identity.name = arena->name(row);
+        }
+        identity.templates.push_back(face.id);
+        faces.emplace_back(face.id, face);
+    }
+    size_t buckets = PersistentMap<int>::bucket_count_for(faces.size());
+    next->faces.assign(std::move(faces), buckets);
+
+    std::vector<std::pair<uint64_t, std::shared_ptr<const GalleryIdentity>>> grouped;
+    grouped.reserve(identities.size());
+    for (auto &[identity_id, identity] : identities)
+    {
+        if (this->centroid_mode_)
+        {
+            compute_centroid(identity, *next);
+        }
+        grouped.emplace_back(identity_id, std::make_shared<const GalleryIdentity>(std::move(identity)));
+    }
+    next->identities.assign(std::move(grouped), buckets);
+
+    // 分片数按人脸库规模决定，之后不随注册变化，重启时重新决定
+    size_t shards = ShardedIndex::auto_shard_count(entry_count(*next, this->centroid_mode_));
+    size_t changes = 0;
+    bool from_snapshot = this->load_snapshot(*next, shards, changes);
+    if (!from_snapshot)
+    {
+        this->rebuild(*next, shards);
+    }
+    if (this->binary_mode_)
+    {
+        next->binary = this->make_binary(*next);
+    }
+    this->update_matcher(*next, GALLERY_FLAT_MAX_SIZE);
+
+    size_t face_count = next->faces.size();
+    size_t identity_count = next->identities.size();
+    size_t memory = next->index->memory_usage() + (next->binary ? next->binary->memory_usage() : 0);
+    bool flat = next->flat != nullptr;
+    size_t tombstones = next->index->tombstones();
+    size_t arena_memory = next->arena ? next->arena->memory_usage() : 0;
+    this->publish(std::move(next));
+    if (!from_snapshot)
+    {
+        this->save_snapshot_locked();
+    }
+    this->maybe_compact();
+    lock.unlock();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOGI("人脸库加载完成: " << face_count << " faces, "
+                            << identity_count << " identities, "
+                            << (this->centroid_mode_ ? "centroid" : "template") << " index, "
+                            << (from_snapshot ? "from snapshot +" + std::to_string(changes) + " changes" : std::string("rebuilt")) << ", " << elapsed << " ms (read "
+                            << read_ms << " ms), arena " << arena_memory / (1024 * 1024) << " MB, peak RSS "
+                            << peak_rss_mb() << " MB, "
+                            << scalar_kind_name(this->scalar_kind_) << " index "
+                            << memory / (1024 * 1024) << " MB, " << shards << " shards, "
+                            << tombstones << " tombstones, "
+                            << (flat                  ? std::string("flat ") + FlatIndex::isa_name()
+                                : this->binary_mode_ ? std::string("binary ") + BinaryIndex::isa_name()
+                                                     : std::string("hnsw"))
+                            << " matcher");
+
+    // 量化索引报告相对 f32 精确检索的召回率损失（按模板评估，质心模式不适用）
+    if (this->scalar_kind_ != scalar_kind_t::f32_k && GALLERY_RECALL_SAMPLES > 0 && face_count > 0 &&
+        !flat && !this->centroid_mode_)
+    {
+        double recall = this->evaluate_recall(GALLERY_RECALL_SAMPLES, 3);
+        LOGI(scalar_kind_name(this->scalar_kind_) << " 量化索引 recall@3 = " << recall
+                                                  << " (相对 f32 精确检索 " << (recall - 1.0) * 100.0 << "%)");
+    }
+    return true;
+}
+
+// 核对数据库元数据与当前模型
+bool FaceGallery::check_schema(size_t loaded_dimensions)
+{
+    std::string metric_name = metric_kind_name(this->metric_kind_);
+    std::string stored_dimensions = this->facedatabase_->get_meta("dimensions");
+    std::string stored_metric = this->facedatabase_->get_meta("metric");
+
+    // 旧数据库没有元数据，用第一条特征的长度代替
+    size_t db_dimensions = 0;
+    if (!stored_dimensions.empty())
+    {
+        db_dimensions = std::stoul(stored_dimensions);
+    }
+    else
+    {
+        db_dimensions = loaded_dimensions;
+    }
+
+    if (this->dimensions_ == 0)
+    {
+        this->dimensions_ = db_dimensions;
+    }
+
+    if (db_dimensions != 0 && db_dimensions != this->dimensions_)
+    {
+        LOGE("人脸库特征维度 " << db_dimensions << " 与当前模型 " << this->dimensions_ << " 不一致，拒绝加载");
+        return false;
+    }
+    if (!stored_metric.empty() && stored_metric != metric_name)
+    {
+        LOGE("人脸库度量 " << stored_metric << " 与当前模型 " << metric_name << " 不一致，拒绝加载");
+        return false;
+    }
+
+    if (this->dimensions_ == 0)
+    {
+        return true;
+    }
+    if (stored_dimensions.empty() || stored_metric.empty())
+    {
+        this->facedatabase_->set_meta("dimensions", std::to_string(this->dimensions_));
+        this->facedatabase_->set_meta("metric", metric_name);
+    }
+    return true;
+}
+
+// 载入快照并检查是否与数据库一致
+bool FaceGallery::load_snapshot(GalleryState &next, size_t shards, size_t &changes)
+{
+    changes = 0;
+    if (this->snapshot_path_.empty())
+    {
+        return false;
+    }
+
+    std::shared_ptr<ShardedIndex> snapshot = this->make_index(shards);
+    if (!snapshot->load(this->snapshot_path_))
+    {
+        return false;
+    }
+
+    // 维度和度量必须与当前模型一致
+    if (snapshot->dimensions() != this->metric_.dimensions() ||
+        snapshot->metric_kind() != this->metric_.metric_kind() ||
+        snapshot->scalar_kind() != this->metric_.scalar_kind())
+    {
+        LOGW("索引快照与当前模型不匹配，重建索引");
+        return false;
+    }
+    if (snapshot->connectivity() != this->params_.connectivity)
+    {
+        LOGW("索引快照的 connectivity " << snapshot->connectivity() << " 与设置 " << this->params_.connectivity << " 不一致，重建索引");
+        return false;
+    }
+    snapshot->change_expansion(this->params_.expansion_add, this->params_.expansion_search);
+
+    // 快照之后数据库的变更只涉及少数条目，按变更日志更新这些条目，不必重建
+    std::vector<uint64_t> changed;
+    if (!this->snapshot_changes(changed))
+    {
+        return false;
+    }
+
+    // 载入的索引按并发检索线程数重新分配线程上下文，并为变更留出空间
+    size_t expected = entry_count(next, this->centroid_mode_);
+    if (!snapshot->reserve(expected / shards + expected / (shards * 8) + changed.size() + 1))
+    {
+        LOGW("索引快照扩容失败，重建索引");
+        return false;
+    }
+    if (!this->apply_changes(next, *snapshot, changed))
+    {
+        LOGW("索引快照应用变更失败，重建索引");
+        return false;
+    }
+    changes = changed.size();
+
+    // 条目数一致，且每一个人脸 id（质心模式为身份 id）都在快照中，才认为快照有效
+    if (snapshot->size() != expected)
+    {
+        LOGW("索引快照已过期: snapshot " << snapshot->size() << " vs database " << expected);
+        return false;
+    }
+    if (!this->centroid_mode_)
+    {
+        for (const auto &[id, _] : next.faces)
+        {
+            if (!snapshot->contains(id))
+            {
+                LOGW("索引快照已过期: 缺少 id " << id);
+                return false;
+            }
+        }
+    }
+    else
+    {
+        // 质心随模板变化，除了 id 还要核对向量本身（允许量化误差）
+        std::vector<float> stored(this->dimensions_);
+        for (const auto &[identity_id, identity] : next.identities)
+        {
+            if (identity->centroid.empty() || !snapshot->get(identity_id, stored.data()))
+            {
+                LOGW("索引快照已过期: 缺少身份 " << identity_id);
+                return false;
+            }
+            if (!same_embedding(next, this->metric_kind_, stored.data(), identity->centroid.data()))
+            {
+                LOGW("索引快照已过期: 身份 " << identity_id << " 的质心已变化");
+                return false;
+            }
+        }
+    }
+
+    next.index = std::move(snapshot);
+    this->dirty_ = changes > 0;
+    return true;
+}
+
+// 快照之后的变更：模板模式为变更过的人脸 id，质心模式为涉及的身份 id
+// 旧快照没有记录变更序号时返回空，由调用方按全部条目核对
+bool FaceGallery::snapshot_changes(std::vector<uint64_t> &keys)
+{
+    keys.clear();
+    std::string stored = this->facedatabase_->get_meta("snapshot_sequence");
+    if (stored.empty())
+    {
+        return true;
+    }
+    std::vector<int64_t> face_ids;
+    std::vector<int64_t> identity_ids;
+    if (!this->facedatabase_->changes_since(std::strtoll(stored.c_str(), nullptr, 10), face_ids, identity_ids))
+    {
+        LOGW("变更日志无法覆盖索引快照，重建索引");
+        return false;
+    }
+    const std::vector<int64_t> &ids = this->centroid_mode_ ? identity_ids : face_ids;
+    keys.assign(ids.begin(), ids.end());
+    return true;
+}
+
+// 应用变更：条目先从快照中删除，数据库中仍存在的再按当前数据加回，所以同一条目重复应用也没有问题
+bool FaceGallery::apply_changes(const GalleryState &next, ShardedIndex &index, const std::vector<uint64_t> &keys)
+{
+    for (uint64_t key : keys)
+    {
+        if (index.contains(key) && !index.remove(key))
+        {
+            return false;
+        }
+
+        const float *vector = nullptr;
+        if (this->centroid_mode_)
+        {
+            const std::shared_ptr<const GalleryIdentity> *identity = next.identities.find(key);
+            if (identity != nullptr && !(*identity)->centroid.empty())
+            {
+                vector = (*identity)->centroid.data();
+            }
+        }
+        else
+        {
+            const GalleryFace *face = next.faces.find(key);
+            if (face != nullptr)
+            {
+                vector = face_embedding(next, *face);
+            }
+        }
+        if (vector != nullptr && !index.add(key, vector))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 索引条目
+std::vector<std::pair<uint64_t, const float *>> FaceGallery::collect_entries(const GalleryState &state) const
+{
+    std::vector<std::pair<uint64_t, const float *>> entries;
+    entries.reserve(entry_count(state, this->centroid_mode_));
+    if (this->centroid_mode_)
+    {
+        // 每个身份一个质心，以身份 id 为 key
+        for (const auto &[identity_id, identity] : state.identities)
+        {
+            if (!identity->centroid.empty())
+            {
+                entries.emplace_back(identity_id, identity->centroid.data());
+            }
+        }
+    }
+    else
+    {
+        for (const auto &[id, face] : state.faces)
+        {
+            const float *embedding = face_embedding(state, face);
+            if (embedding == nullptr)
+            {
+                LOGW("跳过维度不一致的人脸, id: " << id << ", dim: " << face.data->embedding.size());
+                continue;
+            }
+            // 注意：这里的 face.id 必须是正整数 (uint64_t)
+            entries.emplace_back(id, embedding);
+        }
+    }
+    return entries;
+}
+
+// 重建索引：条目分批在线程池的全部线程上并发写入
+void FaceGallery::rebuild(GalleryState &next, size_t shards)
+{
+    next.index = this->make_index(shards);
+
+    std::vector<std::pair<uint64_t, const float *>> entries = this->collect_entries(next);
+
+    // 预留空间（提升性能），按取模分片后各分片大致均匀
+    next.index->reserve(entries.size() / shards + entries.size() / (shards * 8) + 1);
+    auto start = std::chrono::steady_clock::now();
+    size_t added = next.index->build(entries, *this->pool_);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOGI("索引构建完成: " << added << " entries, " << this->pool_->size() << " threads, "
+                          << static_cast<size_t>(elapsed * 1000) << " ms, "
+                          << static_cast<size_t>(added / std::max(elapsed, 1e-3)) << " entries/s");
+    this->dirty_ = true;
+}
+
+// 保存快照
+bool FaceGallery::save_snapshot()
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    return this->save_snapshot_locked();
+}
+
+// 保存快照：先写临时文件再改名，避免中途退出留下损坏的快照
+// 写者互斥，索引此时不会被修改；检索可以同时进行
+bool FaceGallery::save_snapshot_locked()
+{
+    const GalleryState *state = this->state_.load();
+    if (this->snapshot_path_.empty() || !state->index)
+    {
+        return false;
+    }
+    // 记下索引已同步到的变更序号，下次启动只需应用这之后的变更（本进程之后的写入会再应用一次，结果相同）
+    // 载入时仍会核对条目，漏掉的变更会触发重建
+    int64_t sequence = this->synced_sequence_;
+    if (!state->index->save(this->snapshot_path_))
+    {
+        return false;
+    }
+    if (this->facedatabase_->set_meta("snapshot_sequence", std::to_string(sequence)))
+    {
+        this->facedatabase_->prune_changes(sequence);
+    }
+
+    this->dirty_ = false;
+    return true;
+}
+
+// 索引容量不足时扩容
+bool FaceGallery::grow(GalleryState &next, uint64_t key)
+{
+    bool ok;
+    std::shared_ptr<ShardedIndex> grown = next.index->grown_for(key, ok);
+    if (grown)
+    {
+        next.index = std::move(grown);
+    }
+    return ok;
+}
+
+// 小库用暴力检索，大库用 HNSW；HNSW 索引始终维护，切换时无需重建
+void FaceGallery::update_matcher(GalleryState &next, size_t flat_limit)
+{
+    size_t count = entry_count(next, this->centroid_mode_);
+    if (next.flat && count > GALLERY_FLAT_MAX_SIZE)
+    {
+        next.flat.reset();
+        LOGI("人脸数 " << count << " 超过 " << GALLERY_FLAT_MAX_SIZE << "，切换到 HNSW 检索");
+    }
+    else if (!next.flat && next.dimensions > 0 && count <= flat_limit)
+    {
+        std::unique_ptr<FlatIndex> flat = std::make_unique<FlatIndex>(next.dimensions, this->metric_kind_);
+        std::vector<std::pair<uint64_t, const float *>> entries = this->collect_entries(next);
+        bool ok = flat->reserve(entries.size());
+        for (size_t i = 0; ok && i < entries.size(); ++i)
+        {
+            ok = flat->add(entries[i].first, entries[i].second);
+        }
+        if (!ok)
+        {
+            LOGW("暴力检索矩阵分配失败，继续使用 HNSW 检索");
+            return;
+        }
+        next.flat = std::move(flat);
+    }
+}
+
+// 重新计算身份质心并替换索引中的条目
+// 共用的 HNSW 索引中同一个 key 不能并存新旧两个质心，替换期间旧版本的读者会短暂检索不到这个身份
+bool FaceGallery::update_centroid(GalleryState &next, uint64_t identity_id, std::shared_ptr<GalleryIdentity> identity)
+{
+    if (next.index->contains(identity_id) && !next.index->remove(identity_id))
+    {
+        return false;
+    }
+
+    // 最后一张模板被删除，身份随之删除
+    if (identity->templates.empty())
+    {
+        next.identities.erase(identity_id);
+        edit_flat(next, [identity_id](FlatIndex &flat)
+                  {
+                      flat.remove(identity_id);
+                      return true; });
+        return true;
+    }
+
+    compute_centroid(*identity, next);
+    if (identity->centroid.empty() || !this->grow(next, identity_id) ||
+        !next.index->add(identity_id, identity->centroid.data()))
+    {
+        return false;
+    }
+    edit_flat(next, [&](FlatIndex &flat)
+              {
+                  flat.remove(identity_id);
+                  return flat.add(identity_id, identity->centroid.data()); });
+    next.identities.set(identity_id, std::move(identity));
+    return true;
+}
+
+// 添加人脸
+bool FaceGallery::add(const Facedata &face)
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    if (!this->valid_)
+    {
+        LOGE("人脸库与当前模型不匹配，拒绝添加");
+        return false;
+    }
+
+    std::unique_ptr<GalleryState> next = this->copy_state();
+    if (this->dimensions_ == 0)
+    {
+        // 空库第一次注册，以这条特征确定维度并记录到数据库
+        this->init_index(*next, face.embedding.size());
+        next->index->reserve(0);
+        this->facedatabase_->set_meta("dimensions", std::to_string(this->dimensions_));
+        this->facedatabase_->set_meta("metric", metric_kind_name(this->metric_kind_));
+    }
+    if (face.embedding.size() != this->dimensions_)
+    {
+        LOGE("特征维度不一致: " << face.embedding.size() << " vs " << this->dimensions_);
+        return false;
+    }
+
+    // 身份由数据库按姓名分配，调用方未带上时回查一次
+    int identity_id = face.identity_id;
+    if (identity_id < 0)
+    {
+        std::vector<Facedata> rows = this->facedatabase_->find_by_id(static_cast<int>(face.id));
+        identity_id = rows.empty() ? -1 : rows.front().identity_id;
+    }
+    if (identity_id < 0)
+    {
+        LOGE("人脸没有身份, id: " << face.id);
+        return false;
+    }
+
+    if (this->compacting_)
+    {
+        this->compaction_changes_.push_back(this->centroid_mode_ ? static_cast<uint64_t>(identity_id) : face.id);
+    }
+
+    next->faces.set(face.id, registered_face(face, identity_id));
+
+    const std::shared_ptr<const GalleryIdentity> *existing = next->identities.find(identity_id);
+    std::shared_ptr<GalleryIdentity> identity = existing == nullptr
+                                                    ? std::make_shared<GalleryIdentity>()
+                                                    : std::make_shared<GalleryIdentity>(**existing);
+    identity->name = face.name;
+    identity->templates.push_back(face.id);
+
+    // 新条目先写入共用的 HNSW 索引再发布版本；旧版本的读者检索到它时在 faces 中查不到，会直接跳过
+    if (this->centroid_mode_)
+    {
+        if (!this->update_centroid(*next, identity_id, identity))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        next->identities.set(identity_id, identity);
+        if (!this->grow(*next, face.id) || !next->index->add(face.id, face.embedding.data()) ||
+            (next->binary && !next->binary->add(face.id, face.embedding.data())))
+        {
+            return false;
+        }
+        edit_flat(*next, [&](FlatIndex &flat)
+                  { return flat.add(face.id, face.embedding.data()); });
+    }
+    this->update_matcher(*next, GALLERY_FLAT_MAX_SIZE / 2);
+    this->publish(std::move(next));
+    this->dirty_ = true;
+    return true;
+}
+
+// 批量添加人脸
+bool FaceGallery::add_batch(const std::vector<Facedata> &faces)
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    return this->add_batch_locked(faces);
+}
+
+bool FaceGallery::add_batch_locked(const std::vector<Facedata> &faces)
+{
+    if (!this->valid_)
+    {
+        LOGE("人脸库与当前模型不匹配，拒绝添加");
+        return false;
+    }
+    if (faces.empty())
+    {
+        return true;
+    }
+
+    // 先检查整批，再修改新版本
+    size_t dimensions = this->dimensions_ == 0 ? faces.front().embedding.size() : this->dimensions_;
+    std::vector<int> identity_ids;
+    identity_ids.reserve(faces.size());
+    for (const Facedata &face : faces)
+    {
+        if (face.embedding.size() != dimensions)
+        {
+            LOGE("特征维度不一致: " << face.embedding.size() << " vs " << dimensions);
+            return false;
+        }
+        int identity_id = face.identity_id;
+        if (identity_id < 0)
+        {
+            std::vector<Facedata> rows = this->facedatabase_->find_by_id(static_cast<int>(face.id));
+            identity_id = rows.empty() ? -1 : rows.front().identity_id;
+        }
+        if (identity_id < 0)
+        {
+            LOGE("人脸没有身份, id: " << face.id);
+            return false;
+        }
+        identity_ids.push_back(identity_id);
+    }
+
+    std::unique_ptr<GalleryState> next = this->copy_state();
+    if (this->dimensions_ == 0)
+    {
+        this->init_index(*next, dimensions);
+        next->index->reserve(0);
+        this->facedatabase_->set_meta("dimensions", std::to_string(this->dimensions_));
+        this->facedatabase_->set_meta("metric", metric_kind_name(this->metric_kind_));
+    }
+
+    // 更新人脸与身份，同一身份的多张模板只复制一次身份
+    std::unordered_map<uint64_t, std::shared_ptr<GalleryIdentity>> touched;
+    std::vector<std::pair<uint64_t, const float *>> entries;
+    std::vector<uint64_t> keys;
+    entries.reserve(faces.size());
+    keys.reserve(faces.size());
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        const Facedata &face = faces[i];
+        GalleryFace stored = registered_face(face, identity_ids[i]);
+        next->faces.set(face.id, stored);
+
+        std::shared_ptr<GalleryIdentity> &identity = touched[identity_ids[i]];
+        if (!identity)
+        {
+            const std::shared_ptr<const GalleryIdentity> *existing = next->identities.find(identity_ids[i]);
+            identity = existing == nullptr
+                           ? std::make_shared<GalleryIdentity>()
+                           : std::make_shared<GalleryIdentity>(**existing);
+        }
+        identity->name = face.name;
+        identity->templates.push_back(face.id);
+
+        entries.emplace_back(face.id, stored.embedding());
+        keys.push_back(face.id);
+        if (this->compacting_)
+        {
+            this->compaction_changes_.push_back(this->centroid_mode_ ? static_cast<uint64_t>(identity_ids[i]) : face.id);
+        }
+    }
+
+    if (this->centroid_mode_)
+    {
+        for (const auto &[identity_id, identity] : touched)
+        {
+            if (!this->update_centroid(*next, identity_id, identity))
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        for (const auto &[identity_id, identity] : touched)
+        {
+            next->identities.set(identity_id, identity);
+        }
+
+        // 一次预留整批的容量，再并行写入共用的 HNSW 索引
+        bool ok;
+        std::shared_ptr<ShardedIndex> grown = next->index->grown_for(keys, ok);
+        if (!ok)
+        {
+            return false;
+        }
+        if (grown)
+        {
+            next->index = std::move(grown);
+        }
+        size_t added = next->index->build(entries, *this->pool_);
+        if (added != entries.size())
+        {
+            LOGE("批量添加索引失败: " << added << "/" << entries.size());
+            return false;
+        }
+        if (next->binary)
+        {
+            for (const auto &[key, vector] : entries)
+            {
+                if (!next->binary->add(key, vector))
+                {
+                    return false;
+                }
+            }
+        }
+        edit_flat(*next, [&](FlatIndex &flat)
+                  {
+                      for (const auto &[key, vector] : entries)
+                      {
+                          if (!flat.add(key, vector))
+                          {
+                              return false;
+                          }
+                      }
+                      return true; });
+    }
+    this->update_matcher(*next, GALLERY_FLAT_MAX_SIZE / 2);
+    this->publish(std::move(next));
+    this->dirty_ = true;
+    return true;
+}
+
+// 批量注册：读图和特征提取在线程池中并行，数据库按事务分批写入，人脸库只发布一次新版本
+std::vector<int64_t> FaceGallery::enroll_batch(const std::vector<FaceEnrollment> &batch,
+                                               const std::function<std::vector<Facedata>(const std::string &)> &extract,
+                                               const std::function<bool(float)> &same_person)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int64_t> ids(batch.size(), -1);
+
+    // 1. 提取特征
+    std::vector<Facedata> extracted(batch.size());
+    std::vector<char> valid(batch.size(), 0);
+    ThreadPool pool;
+    pool.parallel_for(batch.size(), [&](size_t, size_t i)
+                      {
+        std::vector<Facedata> faces = extract(batch[i].path);
+        if (faces.size() != 1)
+        {
+            LOGW("检测到 " << faces.size() << " 张人脸，跳过: " << batch[i].path);
+            return;
+        }
+        extracted[i] = std::move(faces[0]);
+        extracted[i].name = batch[i].name;
+        valid[i] = 1; });
+
+    // 2. 与单张注册相同，拒绝已属于其他人的人脸
+    std::vector<size_t> rows;
+    std::vector<const float *> embeddings;
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (valid[i])
+        {
+            rows.push_back(i);
+            embeddings.push_back(extracted[i].embedding.data());
+        }
+    }
+    if (!rows.empty() && this->size() > 0)
+    {
+        RcuReadGuard guard = this->pin();
+        std::vector<IdentityMatch> matches(rows.size());
+        std::vector<size_t> found(rows.size());
+        this->search_batch(embeddings, 1, matches.data(), found.data());
+        for (size_t j = 0; j < rows.size(); ++j)
+        {
+            const GalleryIdentity *identity = found[j] > 0 ? this->find_identity(matches[j].identity_id) : nullptr;
+            if (identity == nullptr || !same_person(matches[j].distance))
+            {
+                continue;
+            }
+            if (identity->name != extracted[rows[j]].name)
+            {
+                LOGE("已存在此人脸，请勿重复注册，名字:" << identity->name << ", 图片: " << batch[rows[j]].path);
+                valid[rows[j]] = 0;
+            }
+        }
+    }
+
+    // 同一批次内部也互相比对：按顺序逐张与前面已接受的人脸比较，最相近的一张属于其他人时拒绝，与逐张注册的结果一致
+    size_t dimensions = rows.empty() ? 0 : extracted[rows.front()].embedding.size();
+    FlatIndex earlier(dimensions, this->metric_kind_);
+    earlier.reserve(rows.size());
+    for (size_t i : rows)
+    {
+        const Facedata &face = extracted[i];
+        if (!valid[i] || face.embedding.size() != dimensions)
+        {
+            continue;
+        }
+        GalleryMatch best;
+        if (earlier.search(face.embedding.data(), 1, &best) == 1 && same_person(best.distance) &&
+            extracted[best.id].name != face.name)
+        {
+            LOGE("批次中已有此人脸，请勿重复注册，名字:" << extracted[best.id].name << ", 图片: " << batch[i].path
+                                                         << " 与 " << batch[best.id].path);
+            valid[i] = 0;
+            continue;
+        }
+        earlier.add(i, face.embedding.data());
+    }
+
+    // 3. 分批事务写入数据库，写回 id 与身份
+    std::vector<Facedata> faces;
+    std::vector<std::string> paths;
+    rows.clear();
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (valid[i])
+        {
+            rows.push_back(i);
+            faces.push_back(std::move(extracted[i]));
+            paths.push_back(batch[i].path);
+        }
+    }
+    int64_t written = this->facedatabase_->insert_batch(faces, paths);
+    if (written < static_cast<int64_t>(faces.size()))
+    {
+        std::string failed;
+        for (size_t j = 0; j < faces.size(); ++j)
+        {
+            if (faces[j].id <= 0)
+            {
+                failed += failed.empty() ? paths[j] : ", " + paths[j];
+            }
+        }
+        LOGE("批量注册写入数据库失败: " << faces.size() - std::max<int64_t>(written, 0) << "/" << faces.size() << " 条, 图片: " << failed);
+    }
+    // 批量写入可能创建了新身份，告诉注册日志，之后单张注册同名人脸时不必查数据库
+    FaceJournal *journal;
+    {
+        std::lock_guard<std::mutex> lock(this->writeMutex_);
+        journal = this->journal_;
+    }
+    if (journal != nullptr)
+    {
+        journal->remember_identities(faces);
+    }
+
+    // 4. 写入成功的人脸一次性加入人脸库，失败时删除刚写入的记录
+    std::vector<Facedata> inserted;
+    std::vector<size_t> inserted_rows;
+    for (size_t j = 0; j < faces.size(); ++j)
+    {
+        if (faces[j].id > 0)
+        {
+            inserted_rows.push_back(rows[j]);
+            inserted.push_back(std::move(faces[j]));
+        }
+    }
+    if (!this->add_batch(inserted))
+    {
+        for (const Facedata &face : inserted)
+        {
+            this->facedatabase_->delete_by_id(face.id);
+        }
+        inserted.clear();
+    }
+    for (size_t j = 0; j < inserted.size(); ++j)
+    {
+        ids[inserted_rows[j]] = inserted[j].id;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOGI("批量注册: " << inserted.size() << "/" << batch.size() << ", " << static_cast<int64_t>(ms) << " ms, "
+                     << static_cast<int64_t>(inserted.size() * 1000.0 / std::max(ms, 1.0)) << " faces/s");
+    return ids;
+}
+
+// 删除人脸
+bool FaceGallery::remove(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    return this->remove_batch_locked({id});
+}
+
+// 批量删除人脸
+bool FaceGallery::remove(const std::vector<uint64_t> &ids)
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    return this->remove_batch_locked(ids);
+}
+
+// 批量删除：整批只复制、发布一次版本，同一身份的多张模板只复制一次身份
+bool FaceGallery::remove_batch_locked(const std::vector<uint64_t> &ids)
+{
+    if (!this->state_.load()->index)
+    {
+        return false;
+    }
+    std::unique_ptr<GalleryState> next = this->copy_state();
+    bool ok = true;
+    std::vector<uint64_t> removed;
+    std::unordered_map<uint64_t, std::shared_ptr<GalleryIdentity>> touched;
+    for (uint64_t id : ids)
+    {
+        const GalleryFace *face = next->faces.find(id);
+        if (face == nullptr)
+        {
+            ok = false;
+            continue;
+        }
+        uint64_t identity_id = face->identity_id;
+        next->faces.erase(id);
+        removed.push_back(id);
+        if (this->compacting_)
+        {
+            this->compaction_changes_.push_back(this->centroid_mode_ ? identity_id : id);
+        }
+
+        // 从身份中去掉这张模板
+        auto it = touched.find(identity_id);
+        if (it == touched.end())
+        {
+            const std::shared_ptr<const GalleryIdentity> *existing = next->identities.find(identity_id);
+            if (existing == nullptr)
+            {
+                continue;
+            }
+            it = touched.emplace(identity_id, std::make_shared<GalleryIdentity>(**existing)).first;
+        }
+        std::vector<uint64_t> &templates = it->second->templates;
+        templates.erase(std::remove(templates.begin(), templates.end(), id), templates.end());
+    }
+    if (removed.empty())
+    {
+        return false;
+    }
+
+    std::shared_ptr<ShardedIndex> index = next->index;
+    for (const auto &[identity_id, identity] : touched)
+    {
+        if (this->centroid_mode_)
+        {
+            this->update_centroid(*next, identity_id, identity);
+        }
+        else if (identity->templates.empty())
+        {
+            next->identities.erase(identity_id);
+        }
+        else
+        {
+            next->identities.set(identity_id, identity);
+        }
+    }
+    if (!this->centroid_mode_)
+    {
+        edit_flat(*next, [&](FlatIndex &flat)
+                  {
+                      for (uint64_t id : removed)
+                      {
+                          flat.remove(id);
+                      }
+                      return true; });
+    }
+    this->update_matcher(*next, GALLERY_FLAT_MAX_SIZE / 2);
+    this->publish(std::move(next));
+
+    // 先发布不含这些人脸的版本，再从共用的 HNSW 索引删除；期间检索到它们的读者在 faces 中查不到，会直接跳过
+    if (!this->centroid_mode_)
+    {
+        for (uint64_t id : removed)
+        {
+            ok = index->remove(id) && ok;
+        }
+    }
+    this->dirty_ = true;
+    this->maybe_compact();
+    return ok;
+}
+
+// 设置注册写后日志
+void FaceGallery::set_journal(FaceJournal *journal)
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    this->journal_ = journal;
+}
+
+// 同步数据库中其他连接的写入：按变更日志找出变化的人脸，逐个与数据库核对
+bool FaceGallery::sync()
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    if (!this->valid_)
+    {
+        return false;
+    }
+    int64_t sequence = this->facedatabase_->change_sequence();
+    if (sequence < 0)
+    {
+        return false;
+    }
+    if (sequence == this->synced_sequence_)
+    {
+        return true;
+    }
+
+    std::vector<int64_t> face_ids;
+    std::vector<int64_t> identity_ids;
+    bool ok;
+    if (this->facedatabase_->changes_since(this->synced_sequence_, face_ids, identity_ids))
+    {
+        std::vector<uint64_t> ids(face_ids.begin(), face_ids.end());
+        ok = this->sync_faces(ids, [this](uint64_t id, Facedata &row)
+                              {
+                                  std::vector<Facedata> rows = this->facedatabase_->find_by_id(static_cast<int>(id));
+                                  if (rows.empty())
+                                  {
+                                      return false;
+                                  }
+                                  row = std::move(rows.front());
+                                  return true; });
+    }
+    else
+    {
+        // 变更日志已被其他进程清理（保存快照时），读取整个人脸表核对全部人脸
+        LOGW("变更日志不完整，与数据库全量核对");
+        FaceArena arena;
+        if (!this->facedatabase_->load_arena(arena))
+        {
+            return false;
+        }
+        std::unordered_map<uint64_t, size_t> rows;
+        rows.reserve(arena.size());
+        std::vector<uint64_t> ids;
+        ids.reserve(arena.size());
+        for (size_t row = 0; row < arena.size(); ++row)
+        {
+            rows[arena.id(row)] = row;
+            ids.push_back(arena.id(row));
+        }
+        for (const auto &[id, _] : this->state_.load()->faces)
+        {
+            if (rows.find(id) == rows.end())
+            {
+                ids.push_back(id);
+            }
+        }
+        ok = this->sync_faces(ids, [&](uint64_t id, Facedata &row)
+                              {
+                                  auto it = rows.find(id);
+                                  if (it == rows.end() || arena.identity_id(it->second) < 0)
+                                  {
+                                      return false;
+                                  }
+                                  row.id = static_cast<int>(id);
+                                  row.identity_id = arena.identity_id(it->second);
+                                  row.name = arena.name(it->second);
+                                  row.embedding.assign(arena.embedding(it->second), arena.embedding(it->second) + arena.dimensions());
+                                  return true; });
+    }
+    if (ok)
+    {
+        this->synced_sequence_ = sequence;
+    }
+    return ok;
+}
+
+// 数据库中已不存在的人脸从索引删除；新增的，或身份、姓名、特征有变化的重新加入
+// 本进程自己的写入已在索引中且与数据库一致，直接跳过
+bool FaceGallery::sync_faces(const std::vector<uint64_t> &ids, const std::function<bool(uint64_t, Facedata &)> &lookup)
+{
+    std::vector<uint64_t> removed;
+    std::vector<Facedata> added;
+    {
+        const GalleryState *state = this->state_.load();
+        for (uint64_t id : ids)
+        {
+            Facedata row;
+            bool in_database = lookup(id, row);
+            if (!in_database && this->journal_ != nullptr && this->journal_->in_flight(id))
+            {
+                // 本进程刚注册、还在写后日志中的人脸，数据库中暂时没有
+                continue;
+            }
+            const GalleryFace *face = state->faces.find(id);
+            if (face != nullptr)
+            {
+                const float *embedding = face_embedding(*state, *face);
+                if (in_database && face->identity_id == row.identity_id && face->name() == row.name &&
+                    embedding != nullptr &&
+                    row.embedding.size() == state->dimensions &&
+                    same_embedding(*state, this->metric_kind_, embedding, row.embedding.data()))
+                {
+                    continue;
+                }
+                removed.push_back(id);
+            }
+            if (in_database)
+            {
+                if (this->dimensions_ != 0 && row.embedding.size() != this->dimensions_)
+                {
+                    LOGW("跳过维度不一致的人脸, id: " << id << ", 维度 " << row.embedding.size());
+                    continue;
+                }
+                added.push_back(std::move(row));
+            }
+        }
+    }
+    if (removed.empty() && added.empty())
+    {
+        return true;
+    }
+
+    if (!removed.empty())
+    {
+        this->remove_batch_locked(removed);
+    }
+    if (!this->add_batch_locked(added))
+    {
+        LOGE("同步数据库新增人脸失败: " << added.size() << " faces");
+        return false;
+    }
+    LOGI("同步数据库变更: +" << added.size() << " -" << removed.size() << " faces");
+    return true;
+}
+
+// 后台监视：定期读取 data_version，其他连接提交写入后同步一次；同步失败时下次继续重试
+void FaceGallery::watch()
+{
+    int64_t synced_version = -1;
+    std::unique_lock<std::mutex> lock(this->watchMutex_);
+    while (!this->watchWake_.wait_for(lock, std::chrono::milliseconds(GALLERY_WATCH_INTERVAL_MS), [this]
+                                      { return this->stopping_.load(); }))
+    {
+        int64_t version = this->facedatabase_->data_version();
+        if (version < 0 || version == synced_version)
+        {
+            continue;
+        }
+        lock.unlock();
+        if (this->sync())
+        {
+            synced_version = version;
+        }
+        lock.lock();
+    }
+}
+
+// 删除积累到一定比例时启动后台压缩
+void FaceGallery::maybe_compact()
+{
+    const GalleryState *state = this->state_.load();
+    if (GALLERY_COMPACT_RATIO <= 0 || !state->index)
+    {
+        return;
+    }
+    size_t dead = state->index->tombstones();
+    size_t total = dead + state->index->size();
+    if (dead < GALLERY_COMPACT_MIN_TOMBSTONES || dead < total * GALLERY_COMPACT_RATIO)
+    {
+        return;
+    }
+    if (this->start_compaction())
+    {
+        LOGI("索引已删除节点 " << dead << "/" << total << "，开始后台压缩");
+    }
+}
+
+// 启动后台压缩
+bool FaceGallery::start_compaction()
+{
+    bool expected = false;
+    if (!this->compacting_.compare_exchange_strong(expected, true))
+    {
+        return false;
+    }
+
+    // 上一次压缩的线程已在发布后退出，这里只回收
+    if (this->compactor_.joinable())
+    {
+        this->compactor_.join();
+    }
+    this->compactor_ = std::thread(&FaceGallery::run_compaction, this);
+    return true;
+}
+
+// 修改 HNSW 参数
+bool FaceGallery::set_index_params(const GalleryIndexParams &params)
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    if (params.connectivity < 2 || params.expansion_add == 0 || params.expansion_search == 0)
+    {
+        LOGE("无效的索引参数: connectivity " << params.connectivity << ", expansion_add " << params.expansion_add
+                                           << ", expansion_search " << params.expansion_search);
+        return false;
+    }
+    bool rebuild = params.connectivity != this->params_.connectivity || params.expansion_add != this->params_.expansion_add;
+    if (rebuild && this->compacting_)
+    {
+        LOGW("索引正在重建，稍后再修改参数");
+        return false;
+    }
+
+    this->params_ = params;
+    const GalleryState *state = this->state_.load();
+    if (state->index)
+    {
+        // 检索参数立即作用于当前索引；图结构参数等重建后的新索引生效
+        state->index->change_expansion(params.expansion_add, params.expansion_search);
+    }
+    LOGI("索引参数: connectivity " << params.connectivity << ", expansion_add " << params.expansion_add
+                                   << ", expansion_search " << params.expansion_search
+                                   << (rebuild && state->index ? "，后台重建索引" : ""));
+    return !rebuild || !state->index || this->start_compaction();
+}
+
+GalleryIndexParams FaceGallery::index_params() const
+{
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    return this->params_;
+}
+
+// 手动压缩
+bool FaceGallery::compact()
+{
+    bool expected = false;
+    if (!this->compacting_.compare_exchange_strong(expected, true))
+    {
+        return false;
+    }
+    return this->run_compaction();
+}
+
+// 压缩：重建期间读者继续检索旧索引，写者继续写入旧索引并记录 key
+bool FaceGallery::run_compaction()
+{
+    auto start = std::chrono::steady_clock::now();
+    GalleryState base;
+    std::shared_ptr<ShardedIndex> index;
+    {
+        std::lock_guard<std::mutex> lock(this->writeMutex_);
+        base = *this->state_.load();
+        this->compaction_changes_.clear();
+        if (base.index)
+        {
+            index = this->make_index(base.index->shard_count());
+        }
+    }
+    if (!base.index)
+    {
+        this->compacting_ = false;
+        return false;
+    }
+    size_t tombstones = base.index->tombstones();
+
+    // base 持有人脸数据的引用，锁外重建时不会被释放
+    std::vector<std::pair<uint64_t, const float *>> entries = this->collect_entries(base);
+    size_t shards = index->shard_count();
+    index->reserve(entries.size() / shards + entries.size() / (shards * 8) + 1);
+    ThreadPool pool(GALLERY_COMPACT_THREADS);
+    index->build(entries, pool, &this->stopping_);
+    std::shared_ptr<BinaryIndex> binary = base.binary ? this->make_binary(base) : nullptr;
+    base = GalleryState();
+
+    std::lock_guard<std::mutex> lock(this->writeMutex_);
+    if (this->stopping_)
+    {
+        this->compacting_ = false;
+        return false;
+    }
+
+    // 重放重建期间的写入：以最新版本为准，删掉新索引中过时的条目，补上新增或变化的条目
+    std::unique_ptr<GalleryState> next = this->copy_state();
+    next->index = std::move(index);
+    next->binary = std::move(binary);
+    for (uint64_t key : this->compaction_changes_)
+    {
+        bool existed = next->index->contains(key);
+        if (existed && !next->index->remove(key))
+        {
+            continue;
+        }
+        const float *vector = this->entry_vector(*next, key);
+        if (vector != nullptr && this->grow(*next, key))
+        {
+            next->index->add(key, vector);
+            // 签名索引只追加，已有的行保持不变（模板模式下同一 key 的特征不会变化）
+            if (!existed && next->binary)
+            {
+                next->binary->add(key, vector);
+            }
+        }
+    }
+    size_t replayed = this->compaction_changes_.size();
+    this->compaction_changes_.clear();
+    this->publish(std::move(next));
+    this->dirty_ = true;
+    this->compacting_ = false;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOGI("索引压缩完成: 清除 " << tombstones << " 个已删除节点, " << entries.size() << " entries, 重放 "
+                              << replayed << " 次写入, " << elapsed << " ms");
+    return true;
+}
+
+// 固定当前版本
+RcuReadGuard FaceGallery::pin() const
+{
+    return RcuReadGuard();
+}
+
+// 向量检索
+std::vector<GalleryMatch> FaceGallery::search(const float *embedding, size_t k) const
+{
+    std::vector<GalleryMatch> matches(k);
+    matches.resize(this->search(embedding, k, matches.data()));
+    return matches;
+}
+
+// 向量检索，结果写入调用方的缓冲区
+size_t FaceGallery::search(const float *embedding, size_t k, GalleryMatch *out) const
+{
+    RcuReadGuard guard;
+    return this->search(*this->state_.load(), embedding, k, out);
+}
+
+size_t FaceGallery::search(const GalleryState &state, const float *embedding, size_t k, GalleryMatch *out) const
+{
+    if (entry_count(state, this->centroid_mode_) == 0 || k == 0)
+    {
+        return 0;
+    }
+
+    // 小规模人脸库直接暴力检索，结果精确
+    if (state.flat)
+    {
+        return state.flat->search(embedding, k, out);
+    }
+
+    // 量化索引多取一些候选，再用 f32 特征重新计算距离；签名扫描的距离是汉明距离，总是精排
+    bool binary = state.binary != nullptr;
+    bool rerank = binary || this->scalar_kind_ != scalar_kind_t::f32_k;
+    size_t wanted = binary ? k * GALLERY_BINARY_CANDIDATES : rerank ? k * GALLERY_RERANK_FACTOR : k;
+
+    // 候选放在线程局部缓冲区，容量稳定后不再分配内存
+    thread_local std::vector<GalleryMatch> candidates;
+    candidates.resize(wanted);
+    candidates.resize(binary ? state.binary->search(embedding, wanted, candidates.data())
+                             : state.index->search(embedding, wanted, candidates.data()));
+
+    // 共用索引中可能有尚未发布或已删除的条目，以当前版本为准过滤
+    const byte_t *query = reinterpret_cast<const byte_t *>(embedding);
+    size_t kept = 0;
+    for (const GalleryMatch &candidate : candidates)
+    {
+        const float *vector = this->entry_vector(state, candidate.id);
+        if (vector == nullptr)
+        {
+            continue;
+        }
+        GalleryMatch &match = candidates[kept++];
+        match = candidate;
+        if (rerank)
+        {
+            match.distance = static_cast<float>(state.exact_metric(query, reinterpret_cast<const byte_t *>(vector)));
+        }
+    }
+
+    if (binary)
+    {
+        // 数据库 id 被复用时签名索引中可能有同一 key 的旧行，精排后距离相同、排序后相邻
+        std::sort(candidates.begin(), candidates.begin() + kept,
+                  [](const GalleryMatch &a, const GalleryMatch &b)
+                  { return a.distance < b.distance || (a.distance == b.distance && a.id < b.id); });
+        kept = std::unique(candidates.begin(), candidates.begin() + kept,
+                           [](const GalleryMatch &a, const GalleryMatch &b)
+                           { return a.id == b.id; }) -
+               candidates.begin();
+    }
+
+    size_t count = std::min(k, kept);
+    if (rerank && !binary)
+    {
+        std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.begin() + kept,
+                          [](const GalleryMatch &a, const GalleryMatch &b)
+                          { return a.distance < b.distance; });
+    }
+    std::copy(candidates.begin(), candidates.begin() + count, out);
+    return count;
+}
+
+// 索引条目对应的向量
+const float *FaceGallery::entry_vector(const GalleryState &state, uint64_t key) const
+{
+    if (this->centroid_mode_)
+    {
+        const std::shared_ptr<const GalleryIdentity> *identity = state.identities.find(key);
+        return identity == nullptr || (*identity)->centroid.empty() ? nullptr : (*identity)->centroid.data();
+    }
+    const GalleryFace *face = state.faces.find(key);
+    return face == nullptr ? nullptr : face_embedding(state, *face);
+}
+
+// 按身份检索
+size_t FaceGallery::search_identities(const float *embedding, size_t k, IdentityMatch *out) const
+{
+    RcuReadGuard guard;
+    return this->search_identities(*this->state_.load(), embedding, k, out);
+}
+
+size_t FaceGallery::search_identities(const GalleryState &state, const float *embedding, size_t k, IdentityMatch *out) const
+{
+    if (entry_count(state, this->centroid_mode_) == 0 || k == 0)
+    {
+        return 0;
+    }
+
+    // 候选和分组放在线程局部缓冲区，容量稳定后不再分配内存
+    thread_local std::vector<GalleryMatch> hits;
+    thread_local std::vector<IdentityMatch> groups;
+    thread_local std::vector<uint32_t> counts;
+    groups.clear();
+    counts.clear();
+
+    const byte_t *query = reinterpret_cast<const byte_t *>(embedding);
+    if (this->centroid_mode_)
+    {
+        // 质心检索得到身份，再在身份的模板中找最近的一张
+        // max 聚合用最近模板的距离，mean 聚合直接用到质心的距离
+        hits.resize(k);
+        size_t count = this->search(state, embedding, k, hits.data());
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::shared_ptr<const GalleryIdentity> *identity = state.identities.find(hits[i].id);
+            if (identity == nullptr)
+            {
+                continue;
+            }
+            IdentityMatch match = {hits[i].id, 0, std::numeric_limits<float>::max()};
+            for (uint64_t id : (*identity)->templates)
+            {
+                const GalleryFace *face = state.faces.find(id);
+                const float *vector = face == nullptr ? nullptr : face_embedding(state, *face);
+                if (vector == nullptr)
+                {
+                    continue;
+                }
+                float distance = static_cast<float>(
+                    state.exact_metric(query, reinterpret_cast<const byte_t *>(vector)));
+                if (distance < match.distance)
+                {
+                    match.face_id = id;
+                    match.distance = distance;
+                }
+            }
+            if (this->mean_scoring_)
+            {
+                match.distance = hits[i].distance;
+            }
+            groups.push_back(match);
+        }
+    }
+    else
+    {
+        // 多取一些模板，按身份合并；结果按距离升序，每个身份第一次出现的就是最近模板
+        // mean 聚合只平均候选中命中的模板
+        hits.resize(k * GALLERY_TEMPLATE_FANOUT);
+        size_t count = this->search(state, embedding, hits.size(), hits.data());
+        for (size_t i = 0; i < count; ++i)
+        {
+            const GalleryFace *face = state.faces.find(hits[i].id);
+            if (face == nullptr)
+            {
+                continue;
+            }
+            uint64_t identity_id = static_cast<uint64_t>(face->identity_id);
+            size_t g = 0;
+            while (g < groups.size() && groups[g].identity_id != identity_id)
+            {
+                ++g;
+            }
+            if (g == groups.size())
+            {
+                groups.push_back({identity_id, hits[i].id, hits[i].distance});
+                counts.push_back(1);
+            }
+            else if (this->mean_scoring_)
+            {
+                groups[g].distance += hits[i].distance;
+                ++counts[g];
+            }
+        }
+        for (size_t g = 0; g < groups.size(); ++g)
+        {
+            groups[g].distance /= static_cast<float>(counts[g]);
+        }
+    }
+
+    size_t count = std::min(k, groups.size());
+    std::partial_sort(groups.begin(), groups.begin() + count, groups.end(),
+                      [](const IdentityMatch &a, const IdentityMatch &b)
+                      { return a.distance < b.distance; });
+    std::copy(groups.begin(), groups.begin() + count, out);
+    return count;
+}
+
+// 批量检索
+void FaceGallery::search_batch(const std::vector<const float *> &embeddings, size_t k, IdentityMatch *out, size_t *found) const
+{
+    // 整批使用同一个版本；工作线程在调用线程的读临界区内执行，无需各自进入
+    RcuReadGuard guard;
+    const GalleryState &state = *this->state_.load();
+    if (entry_count(state, this->centroid_mode_) == 0)
+    {
+        std::fill(found, found + embeddings.size(), 0);
+        return;
+    }
+
+    // 每张人脸一个任务，usearch 的 search 本身是线程安全的
+    // 线程池正被其他调用（其他路的批量检索、建索引）占用时在当前线程依次检索，不排队等待
+    auto search_face = [&](size_t, size_t i)
+    { found[i] = this->search_identities(state, embeddings[i], k, out + i * k); };
+    if (!this->pool_->try_parallel_for(embeddings.size(), std::ref(search_face)))
+    {
+        for (size_t i = 0; i < embeddings.size(); ++i)
+        {
+            search_face(0, i);
+        }
+    }
+}
+
+// 识别：一帧中的所有人脸一次批量检索，候选按身份合并
+void FaceGallery::recognize(std::vector<FaceRecognition> &results, size_t k, const std::function<GalleryScore(float)> &score) const
+{
+    if (results.empty() || k == 0 || this->size() == 0)
+    {
+        return;
+    }
+
+    // 固定当前版本，注册/删除可以同时进行，检索结果中的身份指针在本函数内保持有效
+    RcuReadGuard guard = this->pin();
+
+    // 一帧中的所有人脸一次提交，在线程池中并行检索
+    std::vector<const float *> embeddings;
+    embeddings.reserve(results.size());
+    for (const auto &result : results)
+    {
+        embeddings.push_back(result.face.embedding.data());
+    }
+    std::vector<IdentityMatch> matches(results.size() * k);
+    std::vector<size_t> found(results.size());
+    this->search_batch(embeddings, k, matches.data(), found.data());
+
+    for (size_t f = 0; f < results.size(); ++f)
+    {
+        FaceRecognition &result = results[f];
+        result.candidates.reserve(found[f]);
+        for (size_t i = 0; i < found[f]; ++i)
+        {
+            const IdentityMatch &match = matches[f * k + i]; // 按身份合并，距离升序
+            const GalleryIdentity *identity = this->find_identity(match.identity_id); // 按引用读取，不拷贝
+            if (identity == nullptr)
+            {
+                continue;
+            }
+
+            // 直接由索引返回的距离换算，不再重新计算
+            GalleryScore scored = score(match.distance);
+
+            FaceCandidate candidate;
+            candidate.id = static_cast<int>(match.face_id);
+            candidate.identity_id = static_cast<int>(match.identity_id);
+            candidate.name = identity->name;
+            candidate.similarity = scored.similarity;
+            candidate.accepted = scored.accepted;
+            result.candidates.push_back(std::move(candidate));
+
+            // 最佳候选达到阈值时作为识别结果
+            if (result.candidates.size() == 1 && scored.accepted)
+            {
+                result.face.id = static_cast<int>(match.face_id);
+                result.face.identity_id = static_cast<int>(match.identity_id);
+                result.face.name = identity->name;
+                result.face.score = scored.score;
+            }
+        }
+    }
+}
+
+// 抽样评估召回率：以库中的特征为查询，对比 f32 暴力检索的 top-k
+double FaceGallery::evaluate_recall(size_t samples, size_t k) const
+{
+    RcuReadGuard guard;
+    const GalleryState &state = *this->state_.load();
+    if (state.faces.empty() || samples == 0 || k == 0)
+    {
+        return 1.0;
+    }
+
+    std::vector<std::pair<uint64_t, const float *>> faces;
+    faces.reserve(state.faces.size());
+    for (const auto &[id, face] : state.faces)
+    {
+        if (const float *embedding = face_embedding(state, face))
+        {
+            faces.emplace_back(id, embedding);
+        }
+    }
+
+    size_t stride = std::max<size_t>(faces.size() / samples, 1);
+    size_t hits = 0;
+    size_t total = 0;
+    std::vector<GalleryMatch> exact(faces.size());
+    std::vector<GalleryMatch> found(k);
+    for (size_t q = 0; q < faces.size() && total < samples * k; q += stride)
+    {
+        const byte_t *query = reinterpret_cast<const byte_t *>(faces[q].second);
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            exact[i].id = faces[i].first;
+            exact[i].distance = static_cast<float>(
+                state.exact_metric(query, reinterpret_cast<const byte_t *>(faces[i].second)));
+        }
+        size_t top = std::min(k, exact.size());
+        std::partial_sort(exact.begin(), exact.begin() + top, exact.end(),
+                          [](const GalleryMatch &a, const GalleryMatch &b)
+                          { return a.distance < b.distance; });
+
+        size_t count = this->search(state, faces[q].second, top, found.data());
+        for (size_t i = 0; i < top; ++i)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (found[j].id == exact[i].id)
+                {
+                    ++hits;
+                    break;
+                }
+            }
+        }
+        total += top;
+    }
+    return total == 0 ? 1.0 : static_cast<double>(hits) / total;
+}
+
+// 根据 id 获取人脸
+const GalleryFace *FaceGallery::find(uint64_t id) const
+{
+    return this->state_.load()->faces.find(id);
+}
+
+// 根据身份 id 获取身份
+const GalleryIdentity *FaceGallery::find_identity(uint64_t identity_id) const
+{
+    const GalleryState *state = this->state_.load();
+    const std::shared_ptr<const GalleryIdentity> *identity = state->identities.find(identity_id);
+    return identity == nullptr ? nullptr : identity->get();
+}
+
+size_t FaceGallery::size() const
+{
+    RcuReadGuard guard;
+    return entry_count(*this->state_.load(), this->centroid_mode_);
+}
+
+size_t FaceGallery::identity_count() const
+{
+    RcuReadGuard guard;
+    return this->state_.load()->identities.size();
+}
+
+size_t FaceGallery::tombstones() const
+{
+    RcuReadGuard guard;
+    const GalleryState *state = this->state_.load();
+    return state->index ? state->index->tombstones() : 0;
+}
+
+size_t FaceGallery::dimensions() const
+{
+    RcuReadGuard guard;
+    return this->state_.load()->dimensions;
+}
+
+uint64_t FaceGallery::version() const
+{
+    RcuReadGuard guard;
+    return this->state_.load()->version;
+}
+
+bool FaceGallery::valid() const
+{
+    return this->valid_;
+}
+
+// 析构时保存有改动的索引，下次启动可直接载入；等仍在检索的读者离开后再释放
+FaceGallery::~FaceGallery()
+{
+    // 先让监视线程和后台压缩退出，它们都需要写锁；监视线程可能启动压缩，先等它退出
+    {
+        std::lock_guard<std::mutex> lock(this->watchMutex_);
+        this->stopping_ = true;
+    }
+    this->watchWake_.notify_all();
+    if (this->watcher_.joinable())
+    {
+        this->watcher_.join();
+    }
+    if (this->compactor_.joinable())
+    {
+        this->compactor_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->writeMutex_);
+        if (this->dirty_)
+        {
+            this->save_snapshot_locked();
+        }
+    }
+    RcuDomain::instance().synchronize();
+    delete this->state_.load();
+}
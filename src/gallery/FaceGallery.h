@@ -0,0 +1,281 @@
+#pragma once
+#include "common.h"
+#include "config.h"
+#include "ThreadPool.h"
+#include "FlatIndex.h"
+#include "BinaryIndex.h"
+#include "Rcu.h"
+#include "PersistentMap.h"
+#include "ShardedIndex.h"
+#include "database/FaceDatabase.h"
+#include "database/FaceJournal.h"
+#include "usearch/index.hpp"
+#include "usearch/index_plugins.hpp"
+#include "usearch/index_dense.hpp"
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+using namespace unum::usearch;
+
+// 人脸表中的一张人脸
+// 启动时批量加载的人脸只记录所在的特征区和行号，姓名和特征留在特征区中，不为每行单独分配内存；
+// 之后注册的人脸由 data 持有
+struct GalleryFace
+{
+    int id = -1;
+    int identity_id = -1;
+    const FaceArena *arena = nullptr; // 由版本的 arena 持有
+    uint32_t row = 0;                 // 在 arena 中的行，data 为空时有效
+    std::shared_ptr<const Facedata> data;
+
+    std::string_view name() const { return this->data ? std::string_view(this->data->name) : this->arena->name(this->row); }
+
+    // 特征，维度见 FaceGallery::dimensions()
+    const float *embedding() const { return this->data ? this->data->embedding.data() : this->arena->embedding(this->row); }
+};
+
+// 人脸库的一个版本，发布后只读
+// HNSW 索引由各版本共用（usearch 支持增删与检索并发），只在扩容时复制出新分片；
+// 人脸表和身份表是写时复制的分桶映射，每次写入只复制被修改的桶
+struct GalleryState
+{
+    uint64_t version = 0;
+    size_t dimensions = 0;        // 特征维度，尚未确定时为 0
+    metric_punned_t exact_metric; // f32 精排用的度量
+    std::shared_ptr<ShardedIndex> index;  // 分片的 HNSW 索引
+    std::shared_ptr<const FlatIndex> flat; // 小规模人脸库的暴力检索，为空时使用 HNSW
+    std::shared_ptr<BinaryIndex> binary;   // 符号位签名索引，GALLERY_BINARY_PREFILTER 时代替 HNSW；与 index 一样各版本共用
+    std::shared_ptr<const FaceArena> arena; // 启动时批量加载的人脸，各版本共用
+
+
+    // 人脸数据全部加载到内存，特征见 face_embedding()
+    PersistentMap<GalleryFace> faces;
+    PersistentMap<std::shared_ptr<const GalleryIdentity>> identities;
+};
+
+// 人脸库：内存中的向量索引 + id 到人脸数据的映射，三个后端共用
+// 一个身份（人）可以有多张模板，检索结果按身份合并；GALLERY_IDENTITY_CENTROID 为 true 时索引只存每个身份的质心
+// 读写并发采用 RCU：检索不加锁，读取当前发布的版本；注册/删除串行执行，复制出新版本后原子发布
+class FaceGallery
+{
+public:
+    // dimensions 为模型输出的特征维度，传 0 表示从数据库记录或第一条特征推断
+    // quantization 为索引内的存储精度，见 GALLERY_QUANTIZATION
+    FaceGallery(FaceDatabase *facedatabase,
+                const std::string &snapshot_path,
+                size_t dimensions,
+                metric_kind_t metric,
+                const std::string &quantization = GALLERY_QUANTIZATION,
+                const GalleryIndexParams &params = GalleryIndexParams());
+
+    // 工厂方法
+    static std::unique_ptr<FaceGallery> create(FaceDatabase *facedatabase,
+                                               const std::string &snapshot_path,
+                                               size_t dimensions,
+                                               metric_kind_t metric,
+                                               const std::string &quantization = GALLERY_QUANTIZATION,
+                                               const GalleryIndexParams &params = GalleryIndexParams());
+
+    // 从数据库加载人脸数据，快照有效时直接载入索引，否则重建索引并写快照
+    bool load();
+
+    // 添加一张人脸到索引（face.id 必须是数据库中的 id，identity_id 未设置时从数据库读取）
+    bool add(const Facedata &face);
+
+    // 批量添加：整批只复制、发布一次版本，索引条目由线程池并行写入；任一条目无效时整批拒绝
+    bool add_batch(const std::vector<Facedata> &faces);
+
+    // 批量注册（三个后端共用）：extract 读取图片并提取其中的全部人脸，在线程池中并发调用，需要时自行串行推理；
+    // 图片中须恰好一张人脸。与人脸库中或批次中排在前面的其他人的距离满足 same_person 的人脸拒绝注册，
+    // 其余按事务分批写入数据库，再整批加入人脸库。返回每一项的人脸 id，失败的为 -1
+    std::vector<int64_t> enroll_batch(const std::vector<FaceEnrollment> &batch,
+                                      const std::function<std::vector<Facedata>(const std::string &)> &extract,
+                                      const std::function<bool(float)> &same_person);
+
+    // 从索引中删除人脸
+    bool remove(uint64_t id);
+
+    // 批量删除（如删除一个人的全部模板）：整批只复制、发布一次版本；任一 id 不在人脸库中时返回 false（其余照常删除）
+    bool remove(const std::vector<uint64_t> &ids);
+
+    // 注册写后日志（不持有，须比人脸库后析构）：与数据库核对时，已加入人脸库但还在日志中、
+    // 尚未写入数据库的人脸不当作已删除；批量注册新建的身份也记到日志的姓名缓存中
+    void set_journal(FaceJournal *journal);
+
+    // 把其他连接（如管理工具）写入数据库的新增、删除、改名和特征更新应用到索引，检索不受影响
+    // GALLERY_WATCH_INTERVAL_MS 大于 0 时由后台监视线程在数据库变化后调用
+    bool sync();
+
+    // 固定当前版本：返回的守卫存活期间，find()/find_identity() 返回的指针保持有效
+    RcuReadGuard pin() const;
+
+    // 向量检索，返回最相近的 k 个结果（按距离升序）；量化索引会用 f32 特征精排
+    std::vector<GalleryMatch> search(const float *embedding, size_t k) const;
+
+    // 同上，结果写入调用方提供的 out[0, k)，返回结果数；识别热路径使用，不分配内存
+    size_t search(const float *embedding, size_t k, GalleryMatch *out) const;
+
+    // 按身份检索，返回最相近的 k 个身份（按聚合距离升序），结果写入 out[0, k)，返回结果数
+    size_t search_identities(const float *embedding, size_t k, IdentityMatch *out) const;
+
+    // 批量按身份检索，一帧中的多张人脸在线程池中并行检索；线程池正被其他调用占用时在调用线程中依次检索
+    // 第 i 张人脸的结果写入 out[i * k, i * k + k)，结果数写入 found[i]
+    void search_batch(const std::vector<const float *> &embeddings, size_t k, IdentityMatch *out, size_t *found) const;
+
+    // 识别（三个后端共用）：results[i].face 为检测到的人脸，一次批量检索每张人脸最相近的 k 个身份填入 candidates；
+    // score 把索引距离换算成相似度和分数并判断是否达到阈值，最佳候选达到阈值时写入 results[i].face
+    void recognize(std::vector<FaceRecognition> &results, size_t k, const std::function<GalleryScore(float)> &score) const;
+
+    // 抽样评估当前索引相对 f32 精确检索的 recall@k
+    double evaluate_recall(size_t samples, size_t k) const;
+
+    // 根据 id 获取人脸，不存在返回 nullptr；调用方需先 pin()，返回的人脸及其姓名、特征在守卫存活期间有效
+    const GalleryFace *find(uint64_t id) const;
+
+    // 根据身份 id 获取身份，不存在返回 nullptr；调用方需先 pin()
+    const GalleryIdentity *find_identity(uint64_t identity_id) const;
+
+    // 索引中的条目数（模板模式为人脸数，质心模式为身份数）
+    size_t size() const;
+
+    // 身份数量
+    size_t identity_count() const;
+
+    // HNSW 中已删除但尚未清理的节点数
+    size_t tombstones() const;
+
+    // 修改 HNSW 参数：只改 expansion_search 时立即生效；connectivity/expansion_add 变化时在后台重建索引，
+    // 重建期间仍使用旧参数检索。已有压缩/重建在进行时返回 false
+    bool set_index_params(const GalleryIndexParams &params);
+
+    // 当前的 HNSW 参数
+    GalleryIndexParams index_params() const;
+
+    // 立即重建索引清除已删除节点，重建期间检索和注册照常进行；已有压缩在进行时返回 false
+    bool compact();
+
+    // 特征维度，尚未确定时为 0
+    size_t dimensions() const;
+
+    // 当前发布的版本号，每次写入加一
+    uint64_t version() const;
+
+    // 数据库与当前模型不匹配时为 false，此时拒绝所有读写
+    bool valid() const;
+
+    // 将索引写入快照文件
+    bool save_snapshot();
+
+    ~FaceGallery();
+
+private:
+    // 以下函数只在写锁内调用，修改尚未发布的 next 版本
+
+    // 核对数据库记录的维度/度量与当前模型，必要时写入元数据；loaded_dimensions 为已加载特征的维度（空库为 0）
+    bool check_schema(size_t loaded_dimensions);
+
+    // 按确定的维度创建空索引
+    void init_index(GalleryState &next, size_t dimensions);
+
+    // 载入快照，应用快照之后的变更（数量写入 changes）并与数据库核对，快照无法使用时返回 false
+    bool load_snapshot(GalleryState &next, size_t shards, size_t &changes);
+
+    // 读取快照之后变更过的索引条目 key，变更日志无法覆盖快照时返回 false
+    bool snapshot_changes(std::vector<uint64_t> &keys);
+
+    // 把变更过的条目按 next 中的当前数据更新到 index
+    bool apply_changes(const GalleryState &next, ShardedIndex &index, const std::vector<uint64_t> &keys);
+
+    bool add_batch_locked(const std::vector<Facedata> &faces);
+
+    // 批量删除，整批发布一个版本；任一 id 不在人脸库中或删除索引失败时返回 false（其余照常删除）
+    bool remove_batch_locked(const std::vector<uint64_t> &ids);
+
+    // 按数据库当前内容更新 ids 中的人脸，lookup 读取人脸在数据库中的数据，不存在时返回 false
+    bool sync_faces(const std::vector<uint64_t> &ids, const std::function<bool(uint64_t, Facedata &)> &lookup);
+
+    // 后台监视线程
+    void watch();
+
+    // 从内存中的人脸数据重建索引
+    void rebuild(GalleryState &next, size_t shards);
+
+    // key 所在分片容量不足时复制出一个更大的分片，正在检索旧分片的读者不受影响
+    bool grow(GalleryState &next, uint64_t key);
+
+    // 根据人脸数在暴力检索和 HNSW 之间切换，flat_limit 为切回暴力检索的人脸数上限
+    void update_matcher(GalleryState &next, size_t flat_limit);
+
+    // 按 identity（已更新模板、尚未发布）重新计算质心并替换索引中的旧质心；身份已无模板时从索引删除
+    bool update_centroid(GalleryState &next, uint64_t identity_id, std::shared_ptr<GalleryIdentity> identity);
+
+    // 索引条目 (key, 向量)：模板模式为全部人脸特征，质心模式为全部身份质心
+    std::vector<std::pair<uint64_t, const float *>> collect_entries(const GalleryState &state) const;
+
+    // 已删除节点超过 GALLERY_COMPACT_RATIO 时启动后台压缩
+    void maybe_compact();
+
+    // 在后台线程中压缩/重建索引，已有压缩在进行时返回 false
+    bool start_compaction();
+
+    // 按 params_ 创建空的分片索引
+    std::shared_ptr<ShardedIndex> make_index(size_t shards) const;
+
+    // 按 state 中的全部条目建立签名索引
+    std::shared_ptr<BinaryIndex> make_binary(const GalleryState &state) const;
+
+    // 压缩：按当前版本在锁外重建索引，再补上重建期间的写入后发布；调用方已将 compacting_ 置为 true
+    bool run_compaction();
+
+    // 每个分片的 usearch 线程上下文数
+    size_t index_threads() const;
+
+    // 复制当前版本，作为下一个版本的起点
+    std::unique_ptr<GalleryState> copy_state() const;
+
+    // 原子发布新版本，旧版本在没有读者后释放
+    void publish(std::unique_ptr<GalleryState> next);
+
+    bool save_snapshot_locked();
+
+    // 以下函数在读临界区内调用，只读 state
+
+    size_t search(const GalleryState &state, const float *embedding, size_t k, GalleryMatch *out) const;
+    size_t search_identities(const GalleryState &state, const float *embedding, size_t k, IdentityMatch *out) const;
+
+    // 索引条目对应的向量：模板模式为人脸特征，质心模式为身份质心
+    const float *entry_vector(const GalleryState &state, uint64_t key) const;
+
+    FaceDatabase *facedatabase_; // 人脸数据库（不持有）
+    FaceJournal *journal_ = nullptr; // 注册写后日志（不持有，写锁保护）
+    std::string snapshot_path_;  // 索引快照路径
+    size_t dimensions_;          // 特征维度（写者使用，读者使用 state.dimensions）
+    metric_kind_t metric_kind_;  // 距离度量
+    scalar_kind_t scalar_kind_;  // 索引存储精度
+    metric_punned_t metric_;
+    GalleryIndexParams params_; // HNSW 参数（写锁保护）
+
+    bool centroid_mode_ = GALLERY_IDENTITY_CENTROID; // 索引是否按身份质心建立
+    bool mean_scoring_ = false;                      // 身份聚合使用平均距离
+    bool binary_mode_ = GALLERY_BINARY_PREFILTER;    // 大库用签名扫描代替 HNSW
+
+    std::atomic<const GalleryState *> state_{nullptr}; // 当前发布的版本
+    mutable std::mutex writeMutex_;                    // 写者之间互斥，读者不使用
+
+    std::unique_ptr<ThreadPool> pool_; // 批量检索、重建索引共用的线程池
+
+    std::thread compactor_;                     // 后台压缩线程
+    std::atomic<bool> compacting_{false};       // 是否有压缩在进行
+    std::atomic<bool> stopping_{false};         // 析构中，通知压缩线程退出
+    std::vector<uint64_t> compaction_changes_;  // 压缩期间被写入的 key，发布前重放到新索引
+
+    std::thread watcher_;                // 数据库监视线程
+    std::mutex watchMutex_;              // 配合 watchWake_ 等待下一次检查
+    std::condition_variable watchWake_;  // 析构时唤醒监视线程退出
+    int64_t synced_sequence_ = 0;        // 索引已同步到的数据库变更序号（写锁保护）
+
+    bool dirty_ = false;            // 索引在上次保存快照后是否有改动
+    std::atomic<bool> valid_{true}; // 数据库是否与当前模型匹配
+};
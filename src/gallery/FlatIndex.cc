@@ -0,0 +1,285 @@
+#include "FlatIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FLAT_INDEX_X86 1
+#endif
+
+namespace
+{
+    // 点积，a 与 b 的长度 n 为 16 的倍数，a 为 64 字节对齐的矩阵行
+    using dot_fn = float (*)(const float *a, const float *b, size_t n);
+
+    float dot_scalar(const float *a, const float *b, size_t n)
+    {
+        float sum = 0.f;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+#if defined(FLAT_INDEX_X86)
+    __attribute__((target("avx2,fma"))) float dot_avx2(const float *a, const float *b, size_t n)
+    {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (size_t i = 0; i < n; i += 16)
+        {
+            acc0 = _mm256_fmadd_ps(_mm256_load_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_load_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        }
+        acc0 = _mm256_add_ps(acc0, acc1);
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+
+    __attribute__((target("avx512f"))) float dot_avx512(const float *a, const float *b, size_t n)
+    {
+        __m512 acc = _mm512_setzero_ps();
+        for (size_t i = 0; i < n; i += 16)
+        {
+            acc = _mm512_fmadd_ps(_mm512_load_ps(a + i), _mm512_loadu_ps(b + i), acc);
+        }
+        return _mm512_reduce_add_ps(acc);
+    }
+#endif
+
+    // 按 CPU 特性选择点积实现，只在第一次使用时检测
+    struct DotKernel
+    {
+        dot_fn fn = dot_scalar;
+        const char *name = "scalar";
+
+        DotKernel()
+        {
+#if defined(FLAT_INDEX_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+            {
+                fn = dot_avx512;
+                name = "avx512";
+            }
+            else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            {
+                fn = dot_avx2;
+                name = "avx2";
+            }
+#endif
+        }
+    };
+
+    const DotKernel &kernel()
+    {
+        static const DotKernel instance;
+        return instance;
+    }
+
+    constexpr size_t kAlignment = 64;
+    constexpr size_t kLanes = kAlignment / sizeof(float);
+}
+
+FlatIndex::FlatIndex(size_t dimensions, metric_kind_t metric)
+    : dimensions_(dimensions),
+      stride_((dimensions + kLanes - 1) / kLanes * kLanes),
+      metric_(metric)
+{
+}
+
+const char *FlatIndex::isa_name()
+{
+    return kernel().name;
+}
+
+size_t FlatIndex::size() const
+{
+    return this->rows_;
+}
+
+// 预留行数，重新分配对齐内存并拷贝已有数据
+bool FlatIndex::reserve(size_t rows)
+{
+    if (rows <= this->capacity_)
+    {
+        return true;
+    }
+    // aligned_alloc 要求大小是对齐的整数倍（stride_ 已补齐，这里兜住维度为 0 的情况）
+    size_t bytes = (rows * this->stride_ * sizeof(float) + kAlignment - 1) / kAlignment * kAlignment;
+    float *matrix = static_cast<float *>(std::aligned_alloc(kAlignment, std::max(bytes, kAlignment)));
+    if (matrix == nullptr)
+    {
+        LOGE("暴力检索矩阵分配失败: " << rows << " rows");
+        return false;
+    }
+    if (this->matrix_ != nullptr)
+    {
+        std::memcpy(matrix, this->matrix_, this->rows_ * this->stride_ * sizeof(float));
+        std::free(this->matrix_);
+    }
+    this->matrix_ = matrix;
+    this->capacity_ = rows;
+    this->norms_.reserve(rows);
+    this->ids_.reserve(rows);
+    this->rows_by_id_.reserve(rows);
+    return true;
+}
+
+void FlatIndex::clear()
+{
+    this->rows_ = 0;
+    this->norms_.clear();
+    this->ids_.clear();
+    this->rows_by_id_.clear();
+}
+
+// 深拷贝
+std::unique_ptr<FlatIndex> FlatIndex::clone() const
+{
+    std::unique_ptr<FlatIndex> copy = std::make_unique<FlatIndex>(this->dimensions_, this->metric_);
+    if (!copy->reserve(this->capacity_))
+    {
+        return nullptr;
+    }
+    if (this->rows_ > 0)
+    {
+        std::memcpy(copy->matrix_, this->matrix_, this->rows_ * this->stride_ * sizeof(float));
+    }
+    copy->rows_ = this->rows_;
+    copy->norms_ = this->norms_;
+    copy->ids_ = this->ids_;
+    copy->rows_by_id_ = this->rows_by_id_;
+    return copy;
+}
+
+// 添加一行
+bool FlatIndex::add(uint64_t id, const float *embedding)
+{
+    if (this->rows_by_id_.count(id))
+    {
+        return false;
+    }
+    if (this->rows_ == this->capacity_ && !this->reserve(std::max<size_t>(this->capacity_ * 2, 64)))
+    {
+        return false;
+    }
+
+    float *row = this->matrix_ + this->rows_ * this->stride_;
+    std::memcpy(row, embedding, this->dimensions_ * sizeof(float));
+    std::fill(row + this->dimensions_, row + this->stride_, 0.f);
+
+    float norm = 0.f;
+    for (size_t i = 0; i < this->dimensions_; ++i)
+    {
+        norm += row[i] * row[i];
+    }
+
+    // 余弦度量预先归一化，检索时只需一次点积
+    if (this->metric_ == metric_kind_t::cos_k && norm > 0.f)
+    {
+        float inv = 1.f / std::sqrt(norm);
+        for (size_t i = 0; i < this->dimensions_; ++i)
+        {
+            row[i] *= inv;
+        }
+    }
+
+    this->norms_.push_back(norm);
+    this->ids_.push_back(id);
+    this->rows_by_id_[id] = this->rows_;
+    ++this->rows_;
+    return true;
+}
+
+// 删除一行：把最后一行移到被删除的位置，保持矩阵连续
+bool FlatIndex::remove(uint64_t id)
+{
+    auto it = this->rows_by_id_.find(id);
+    if (it == this->rows_by_id_.end())
+    {
+        return false;
+    }
+    size_t row = it->second;
+    size_t last = this->rows_ - 1;
+    if (row != last)
+    {
+        std::memcpy(this->matrix_ + row * this->stride_, this->matrix_ + last * this->stride_, this->stride_ * sizeof(float));
+        this->norms_[row] = this->norms_[last];
+        this->ids_[row] = this->ids_[last];
+        this->rows_by_id_[this->ids_[row]] = row;
+    }
+    this->rows_by_id_.erase(it);
+    this->norms_.pop_back();
+    this->ids_.pop_back();
+    --this->rows_;
+    return true;
+}
+
+// 计算距离
+float FlatIndex::distance(const float *query, float query_norm, size_t row) const
+{
+    float dot = kernel().fn(this->matrix_ + row * this->stride_, query, this->stride_);
+    if (this->metric_ == metric_kind_t::cos_k)
+    {
+        return 1.f - dot;
+    }
+    // l2sq: |q|^2 + |x|^2 - 2 q.x
+    return std::max(query_norm + this->norms_[row] - 2.f * dot, 0.f);
+}
+
+// 暴力检索
+size_t FlatIndex::search(const float *query, size_t k, GalleryMatch *out) const
+{
+    if (this->rows_ == 0 || k == 0)
+    {
+        return 0;
+    }
+
+    // 查询向量补齐到行宽，余弦度量先归一化；缓冲区线程局部复用
+    thread_local std::vector<float> padded;
+    padded.assign(this->stride_, 0.f);
+    std::memcpy(padded.data(), query, this->dimensions_ * sizeof(float));
+    float query_norm = 0.f;
+    for (size_t i = 0; i < this->dimensions_; ++i)
+    {
+        query_norm += padded[i] * padded[i];
+    }
+    if (this->metric_ == metric_kind_t::cos_k && query_norm > 0.f)
+    {
+        float inv = 1.f / std::sqrt(query_norm);
+        for (size_t i = 0; i < this->dimensions_; ++i)
+        {
+            padded[i] *= inv;
+        }
+    }
+
+    // out 维护当前最好的 count 个结果（升序），k 很小，插入排序即可
+    size_t count = 0;
+    for (size_t row = 0; row < this->rows_; ++row)
+    {
+        float d = this->distance(padded.data(), query_norm, row);
+        if (count == k && d >= out[count - 1].distance)
+        {
+            continue;
+        }
+        size_t pos = count < k ? count++ : k - 1;
+        while (pos > 0 && out[pos - 1].distance > d)
+        {
+            out[pos] = out[pos - 1];
+            --pos;
+        }
+        out[pos] = {this->ids_[row], d};
+    }
+    return count;
+}
+
+FlatIndex::~FlatIndex()
+{
+    std::free(this->matrix_);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "common.h"
+#include "GalleryTypes.h"
+#include "usearch/index_plugins.hpp"
+#include <unordered_map>
+
+using namespace unum::usearch;
+
+// 精确暴力检索：特征按行连续存放在 64 字节对齐的矩阵中，用 SIMD 点积逐行扫描
+// 小规模人脸库（几千张以内）比 HNSW 更快，且召回率为 100%
+class FlatIndex
+{
+public:
+    FlatIndex(size_t dimensions, metric_kind_t metric);
+    FlatIndex(const FlatIndex &) = delete;
+    FlatIndex &operator=(const FlatIndex &) = delete;
+
+    // 添加一行特征，id 已存在或内存不足时返回 false
+    bool add(uint64_t id, const float *embedding);
+
+    // 删除一行特征（与最后一行交换）
+    bool remove(uint64_t id);
+
+    // 预留行数，内存不足时返回 false，已有数据不变
+    bool reserve(size_t rows);
+
+    // 清空
+    void clear();
+
+    // 深拷贝（人脸库发布新版本时使用），内存不足时返回空；禁止隐式拷贝以免无意中复制整个矩阵
+    std::unique_ptr<FlatIndex> clone() const;
+
+    // 检索最相近的 k 个结果写入 out，按距离升序，返回结果数；不分配内存
+    size_t search(const float *query, size_t k, GalleryMatch *out) const;
+
+    size_t size() const;
+
+    // 运行时选中的点积实现（avx512 / avx2 / scalar）
+    static const char *isa_name();
+
+    ~FlatIndex();
+
+private:
+    // 计算 query 与第 row 行的距离
+    float distance(const float *query, float query_norm, size_t row) const;
+
+    size_t dimensions_; // 特征维度
+    size_t stride_;     // 每行的 float 数，补齐到 16 的倍数（64 字节）
+    metric_kind_t metric_;
+
+    float *matrix_ = nullptr; // 行优先的特征矩阵，64 字节对齐
+    size_t rows_ = 0;
+    size_t capacity_ = 0;
+
+    std::vector<float> norms_;  // 每行的平方范数（l2sq 使用）
+    std::vector<uint64_t> ids_; // 行号 -> 人脸 id
+    std::unordered_map<uint64_t, size_t> rows_by_id_; // 人脸 id -> 行号
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include "config.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 检索结果
+struct GalleryMatch
+{
+    uint64_t id;    // 人脸 id（质心模式下为身份 id）
+    float distance; // 距离，cos 为 1 - 余弦相似度，l2sq 为欧氏距离的平方
+};
+
+// 按身份合并后的检索结果
+struct IdentityMatch
+{
+    uint64_t identity_id; // 身份 id
+    uint64_t face_id;     // 该身份中距离最近的模板
+    float distance;       // 聚合后的距离，含义同 GalleryMatch::distance
+};
+
+// 识别打分：由索引距离换算，含义由后端决定
+struct GalleryScore
+{
+    float similarity; // 相似度，越大越像，见 FaceCandidate::similarity
+    float score;      // 写入识别结果 Facedata::score 的分数
+    bool accepted;    // 是否达到识别阈值
+};
+
+// 身份：一个人的所有模板
+struct GalleryIdentity
+{
+    std::string name;
+    std::vector<uint64_t> templates; // 模板（人脸 id）
+    std::vector<float> centroid;     // 模板均值，仅质心模式使用
+};
+
+// HNSW 索引参数，含义见 config.h
+struct GalleryIndexParams
+{
+    size_t connectivity = GALLERY_CONNECTIVITY;
+    size_t expansion_add = GALLERY_EXPANSION_ADD;
+    size_t expansion_search = GALLERY_EXPANSION_SEARCH;
+};
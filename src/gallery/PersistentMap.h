@@ -0,0 +1,182 @@
+#pragma once
+#include "common.h"
+#include "config.h"
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// id -> V 的写时复制映射，人脸库的各版本共用未修改的部分
+// key 按取模分到桶（桶数在载入时按规模确定），每个桶是按 key 排序的数组，以 shared_ptr 持有：
+// 复制映射只复制桶指针，修改一个 key 只复制它所在的桶，同一版本内再次修改同一个桶不再复制
+// 桶只被本映射持有时（新版本中刚复制出的桶）直接修改；已发布的版本不会再被修改，读者无需加锁
+template <typename V>
+class PersistentMap
+{
+public:
+    using value_type = std::pair<uint64_t, V>;
+
+    explicit PersistentMap(size_t buckets = GALLERY_STATE_BUCKETS)
+        : buckets_(std::max<size_t>(buckets, 1))
+    {
+    }
+
+    // 按桶依次遍历，同一个桶内按 key 升序
+    class const_iterator
+    {
+    public:
+        const value_type &operator*() const { return (*this->map_->buckets_[this->bucket_])[this->item_]; }
+        const value_type *operator->() const { return &**this; }
+        bool operator==(const const_iterator &other) const { return this->bucket_ == other.bucket_ && this->item_ == other.item_; }
+        bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+        const_iterator &operator++()
+        {
+            ++this->item_;
+            this->skip_empty();
+            return *this;
+        }
+
+    private:
+        friend class PersistentMap;
+        const_iterator(const PersistentMap *map, size_t bucket) : map_(map), bucket_(bucket) { this->skip_empty(); }
+
+        // 跳到下一个非空位置，到末尾时停在 (桶数, 0)
+        void skip_empty()
+        {
+            const auto &buckets = this->map_->buckets_;
+            while (this->bucket_ < buckets.size() &&
+                   (!buckets[this->bucket_] || this->item_ >= buckets[this->bucket_]->size()))
+            {
+                ++this->bucket_;
+                this->item_ = 0;
+            }
+        }
+
+        const PersistentMap *map_;
+        size_t bucket_;
+        size_t item_ = 0;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, this->buckets_.size()); }
+
+    // 桶数：每次修改复制约 size() / bucket_count() 个条目和 bucket_count() 个桶指针，约为 sqrt(size()) 时最省
+    static size_t bucket_count_for(size_t entries)
+    {
+        size_t buckets = GALLERY_STATE_BUCKETS;
+        while (buckets * buckets < entries)
+        {
+            buckets *= 2;
+        }
+        return buckets;
+    }
+
+    size_t size() const { return this->size_; }
+    bool empty() const { return this->size_ == 0; }
+
+    // 查找 key，不存在返回 nullptr；返回的指针在本版本存活期间有效
+    const V *find(uint64_t key) const
+    {
+        const Bucket *bucket = this->buckets_[this->bucket_of(key)].get();
+        if (bucket == nullptr)
+        {
+            return nullptr;
+        }
+        auto it = lower_bound(*bucket, key);
+        return it == bucket->end() || it->first != key ? nullptr : &it->second;
+    }
+
+    bool contains(uint64_t key) const { return this->find(key) != nullptr; }
+
+    // 插入或替换
+    void set(uint64_t key, V value)
+    {
+        Bucket &bucket = this->own(this->bucket_of(key));
+        auto it = lower_bound(bucket, key);
+        if (it != bucket.end() && it->first == key)
+        {
+            it->second = std::move(value);
+            return;
+        }
+        bucket.emplace(it, key, std::move(value));
+        ++this->size_;
+    }
+
+    // 删除 key，不存在返回 false
+    bool erase(uint64_t key)
+    {
+        size_t index = this->bucket_of(key);
+        if (!this->find(key))
+        {
+            return false;
+        }
+        Bucket &bucket = this->own(index);
+        bucket.erase(lower_bound(bucket, key));
+        --this->size_;
+        return true;
+    }
+
+    // 批量建立（载入时使用），替换原有内容并改为 buckets 个桶；entries 中的 key 不能重复
+    // 每个桶只分配一次，不为每个条目单独分配内存
+    void assign(std::vector<value_type> entries, size_t buckets)
+    {
+        this->buckets_.assign(std::max<size_t>(buckets, 1), nullptr);
+        std::vector<size_t> counts(this->buckets_.size(), 0);
+        for (const value_type &entry : entries)
+        {
+            ++counts[this->bucket_of(entry.first)];
+        }
+        for (size_t i = 0; i < this->buckets_.size(); ++i)
+        {
+            if (counts[i] > 0)
+            {
+                this->buckets_[i] = std::make_shared<Bucket>();
+                this->buckets_[i]->reserve(counts[i]);
+            }
+        }
+        for (value_type &entry : entries)
+        {
+            this->buckets_[this->bucket_of(entry.first)]->push_back(std::move(entry));
+        }
+        for (std::shared_ptr<Bucket> &bucket : this->buckets_)
+        {
+            if (bucket)
+            {
+                std::sort(bucket->begin(), bucket->end(), [](const value_type &a, const value_type &b)
+                          { return a.first < b.first; });
+            }
+        }
+        this->size_ = entries.size();
+    }
+
+private:
+    using Bucket = std::vector<value_type>;
+
+    size_t bucket_of(uint64_t key) const { return key % this->buckets_.size(); }
+
+    template <typename B>
+    static auto lower_bound(B &bucket, uint64_t key)
+    {
+        return std::lower_bound(bucket.begin(), bucket.end(), key, [](const value_type &item, uint64_t k)
+                                { return item.first < k; });
+    }
+
+    // 取得可修改的桶：与其他版本共用时先复制
+    Bucket &own(size_t index)
+    {
+        std::shared_ptr<Bucket> &bucket = this->buckets_[index];
+        if (!bucket)
+        {
+            bucket = std::make_shared<Bucket>();
+        }
+        else if (bucket.use_count() > 1)
+        {
+            bucket = std::make_shared<Bucket>(*bucket);
+        }
+        return *bucket;
+    }
+
+    std::vector<std::shared_ptr<Bucket>> buckets_;
+    size_t size_ = 0;
+};
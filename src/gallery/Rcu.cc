@@ -0,0 +1,123 @@
+#include "Rcu.h"
+#include <algorithm>
+#include <thread>
+
+// 线程在域中的登记信息：临界区内占用的槽位、嵌套深度和上次使用的槽位
+struct RcuThreadRecord
+{
+    RcuDomain::Slot *slot = nullptr;
+    size_t depth = 0;
+    size_t hint = 0; // 下次先尝试这个槽位，同一线程反复检索时通常仍空闲
+};
+
+static thread_local RcuThreadRecord record;
+
+RcuDomain &RcuDomain::instance()
+{
+    static RcuDomain domain;
+    return domain;
+}
+
+// 占用一个空闲槽位，从 hint 开始查找；全部被占用时等待其他读者离开
+RcuDomain::Slot *RcuDomain::acquire_slot(size_t &hint)
+{
+    while (true)
+    {
+        for (size_t i = 0; i < GALLERY_MAX_READER_THREADS; ++i)
+        {
+            size_t index = (hint + i) % GALLERY_MAX_READER_THREADS;
+            Slot &slot = this->slots_[index];
+            bool expected = false;
+            if (!slot.used.load(std::memory_order_relaxed) &&
+                slot.used.compare_exchange_strong(expected, true))
+            {
+                hint = index;
+                return &slot;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void RcuDomain::release_slot(Slot *slot)
+{
+    slot->epoch.store(0, std::memory_order_release);
+    slot->used.store(false, std::memory_order_release);
+}
+
+// 进入读临界区：先登记 epoch，之后再读取被保护的指针
+void RcuDomain::read_lock()
+{
+    if (record.depth++ > 0)
+    {
+        return;
+    }
+    record.slot = this->acquire_slot(record.hint);
+    record.slot->epoch.store(this->epoch_.load());
+}
+
+// 离开最外层临界区时归还槽位，槽位数只限制同时在临界区内的线程数
+void RcuDomain::read_unlock()
+{
+    if (--record.depth > 0)
+    {
+        return;
+    }
+    this->release_slot(record.slot);
+    record.slot = nullptr;
+}
+
+// 登记旧版本，epoch 前进一步；之后进入的读者只能读到新版本
+void RcuDomain::retire(std::function<void()> deleter)
+{
+    std::lock_guard<std::mutex> lock(this->retireMutex_);
+    this->retired_.emplace_back(this->epoch_.fetch_add(1), std::move(deleter));
+}
+
+uint64_t RcuDomain::min_reader_epoch() const
+{
+    uint64_t min_epoch = UINT64_MAX;
+    for (const Slot &slot : this->slots_)
+    {
+        uint64_t epoch = slot.epoch.load();
+        if (epoch != 0 && epoch < min_epoch)
+        {
+            min_epoch = epoch;
+        }
+    }
+    return min_epoch;
+}
+
+// 释放摘下时间早于所有读者的旧版本
+void RcuDomain::reclaim()
+{
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(this->retireMutex_);
+        uint64_t min_epoch = this->min_reader_epoch();
+        auto it = std::stable_partition(this->retired_.begin(), this->retired_.end(),
+                                        [&](const std::pair<uint64_t, std::function<void()>> &item)
+                                        { return item.first >= min_epoch; });
+        for (auto done = it; done != this->retired_.end(); ++done)
+        {
+            ready.push_back(std::move(done->second));
+        }
+        this->retired_.erase(it, this->retired_.end());
+    }
+    // 在锁外执行释放，避免析构大对象时阻塞其他写者
+    for (auto &deleter : ready)
+    {
+        deleter();
+    }
+}
+
+// 等待调用前已进入临界区的读者全部离开
+void RcuDomain::synchronize()
+{
+    uint64_t target = this->epoch_.fetch_add(1);
+    while (this->min_reader_epoch() <= target)
+    {
+        std::this_thread::yield();
+    }
+    this->reclaim();
+}
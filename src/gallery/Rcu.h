@@ -0,0 +1,62 @@
+#pragma once
+#include "common.h"
+#include "config.h"
+#include <atomic>
+#include <functional>
+
+// 基于 epoch 的读-复制-更新（RCU）
+// 读者进入临界区时占用一个槽位并登记当前 epoch，离开时归还，只有原子读写，不加锁；
+// 写者原子替换指针发布新版本后，把旧版本交给 retire()，等所有可能读到它的读者离开后再释放
+class RcuDomain
+{
+public:
+    // 进程内共用一个域
+    static RcuDomain &instance();
+
+    // 进入/离开读临界区，可嵌套；同时处于读临界区的线程超过 GALLERY_MAX_READER_THREADS 时等待空闲槽位
+    void read_lock();
+    void read_unlock();
+
+    // 登记一个已摘下的旧版本，deleter 在没有读者引用它之后执行
+    void retire(std::function<void()> deleter);
+
+    // 释放已经没有读者的旧版本
+    void reclaim();
+
+    // 等待当前所有读者离开，然后释放全部旧版本
+    void synchronize();
+
+private:
+    RcuDomain() = default;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> epoch{0}; // 读者进入时的 epoch，0 表示不在临界区
+        std::atomic<bool> used{false};  // 槽位是否已被某个线程占用
+    };
+
+    // 进入最外层临界区时占用一个槽位，离开时归还；hint 为线程上次使用的槽位
+    Slot *acquire_slot(size_t &hint);
+    void release_slot(Slot *slot);
+
+    // 所有读者中最早的 epoch，没有读者时返回 UINT64_MAX
+    uint64_t min_reader_epoch() const;
+
+    Slot slots_[GALLERY_MAX_READER_THREADS];
+    std::atomic<uint64_t> epoch_{1};
+
+    std::mutex retireMutex_;
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_; // (摘下时的 epoch, 释放函数)
+
+    friend struct RcuThreadRecord;
+};
+
+// 读临界区守卫，持有期间读到的版本不会被释放
+class RcuReadGuard
+{
+public:
+    RcuReadGuard() { RcuDomain::instance().read_lock(); }
+    ~RcuReadGuard() { RcuDomain::instance().read_unlock(); }
+    RcuReadGuard(const RcuReadGuard &) = delete;
+    RcuReadGuard &operator=(const RcuReadGuard &) = delete;
+};
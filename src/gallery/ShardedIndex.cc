@@ -0,0 +1,407 @@
+#include "ShardedIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+ShardedIndex::ShardedIndex(const metric_punned_t &metric, const index_dense_config_t &config, size_t shards, size_t threads)
+    : metric_(metric),
+      threads_(threads + std::max<size_t>(shards, 1)), // 分片工作线程也要占用线程上下文
+      pool_(std::make_shared<ThreadPool>(std::max<size_t>(shards, 1)))
+{
+    for (size_t i = 0; i < std::max<size_t>(shards, 1); ++i)
+    {
+        this->shards_.push_back(std::make_shared<index_dense_t>(index_dense_t::make(this->metric_, config)));
+        this->tombstones_.push_back(std::make_shared<std::atomic<size_t>>(0));
+    }
+}
+
+// 自动分片：每个分片不少于 GALLERY_SHARD_MIN_SIZE 条，且不超过 CPU 核数
+size_t ShardedIndex::auto_shard_count(size_t entries, size_t configured)
+{
+    if (configured > 0)
+    {
+        return configured;
+    }
+    size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    size_t wanted = (entries + GALLERY_SHARD_MIN_SIZE - 1) / GALLERY_SHARD_MIN_SIZE;
+    return std::min(std::max<size_t>(wanted, 1), cores);
+}
+
+std::string ShardedIndex::shard_path(const std::string &path, size_t shard, size_t shards)
+{
+    return shards == 1 ? path : path + "." + std::to_string(shard) + "of" + std::to_string(shards);
+}
+
+size_t ShardedIndex::shard_of(uint64_t key) const
+{
+    return key % this->shards_.size();
+}
+
+// 构建进度（在 lambda 外输出，日志中显示函数名）
+static void build_progress(size_t done, size_t total)
+{
+    LOGI("索引构建进度: " << done << "/" << total << " (" << done * 100 / total << "%)");
+}
+
+// 并行构建
+size_t ShardedIndex::build(const std::vector<std::pair<uint64_t, const float *>> &entries, ThreadPool &pool,
+                          const std::atomic<bool> *cancel)
+{
+    size_t batches = (entries.size() + GALLERY_BUILD_BATCH - 1) / GALLERY_BUILD_BATCH;
+    size_t step = std::max<size_t>(entries.size() / 10, 1);
+    bool report = batches >= 10; // 条目较少时构建很快，不输出进度
+    std::atomic<size_t> done{0};
+    std::atomic<size_t> added{0};
+    pool.parallel_for(batches, [&](size_t, size_t batch)
+                      {
+        if (cancel != nullptr && cancel->load())
+        {
+            return;
+        }
+        size_t begin = batch * GALLERY_BUILD_BATCH;
+        size_t end = std::min(begin + GALLERY_BUILD_BATCH, entries.size());
+        size_t count = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            // 向已有索引追加时会复用已删除的节点，经 add() 同步已删除节点数
+            if (this->add(entries[i].first, entries[i].second))
+            {
+                ++count;
+            }
+        }
+        added += count;
+
+        size_t before = done.fetch_add(end - begin);
+        if (report && before / step != (before + end - begin) / step)
+        {
+            build_progress(before + end - begin, entries.size());
+        } });
+    return added.load();
+}
+
+// usearch 添加时优先复用已删除的节点
+bool ShardedIndex::add(uint64_t key, const float *vector)
+{
+    size_t shard = this->shard_of(key);
+    auto result = this->shards_[shard]->add(key, vector);
+    if (!result)
+    {
+        LOGE("添加索引失败, id: " << key << ", " << result.error.release());
+        return false;
+    }
+    std::atomic<size_t> &tombstones = *this->tombstones_[shard];
+    size_t dead = tombstones.load();
+    while (dead > 0 && !tombstones.compare_exchange_weak(dead, dead - 1))
+    {
+    }
+    return true;
+}
+
+bool ShardedIndex::remove(uint64_t key)
+{
+    size_t shard = this->shard_of(key);
+    auto result = this->shards_[shard]->remove(key);
+    if (!result)
+    {
+        LOGE("删除索引失败, id: " << key << ", " << result.error.release());
+        return false;
+    }
+    *this->tombstones_[shard] += result.completed;
+    return true;
+}
+
+bool ShardedIndex::contains(uint64_t key) const
+{
+    return this->shards_[this->shard_of(key)]->contains(key);
+}
+
+bool ShardedIndex::get(uint64_t key, float *vector) const
+{
+    return this->shards_[this->shard_of(key)]->get(key, vector) > 0;
+}
+
+// 检索：各分片取 top-k，合并后取全局 top-k
+size_t ShardedIndex::search(const float *query, size_t k, GalleryMatch *out) const
+{
+    size_t shards = this->shards_.size();
+    if (shards == 1)
+    {
+        auto results = this->shards_[0]->search(query, k);
+        if (!results)
+        {
+            LOGE("索引检索失败: " << results.error.release());
+            return 0;
+        }
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            out[i] = {results[i].member.key, results[i].distance};
+        }
+        return results.size();
+    }
+
+    // 每个分片的结果写入缓冲区中自己的一段，缓冲区线程局部复用
+    thread_local std::vector<GalleryMatch> merged;
+    thread_local std::vector<size_t> counts;
+    merged.resize(shards * k);
+    counts.assign(shards, 0);
+    GalleryMatch *buffer = merged.data();
+    size_t *found = counts.data();
+    auto search_shard = [&](size_t, size_t shard)
+    {
+        auto results = this->shards_[shard]->search(query, k);
+        if (!results)
+        {
+            LOGE("索引检索失败: " << results.error.release());
+            return;
+        }
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            buffer[shard * k + i] = {results[i].member.key, results[i].distance};
+        }
+        found[shard] = results.size();
+    };
+    // 分片线程正在服务其他查询时（多路并发识别），在当前线程依次检索各分片，不排队等待
+    // 以 std::ref 传入，构造 std::function 时不分配内存
+    if (!this->pool_->try_parallel_for(shards, std::ref(search_shard)))
+    {
+        for (size_t shard = 0; shard < shards; ++shard)
+        {
+            search_shard(0, shard);
+        }
+    }
+
+    // 把各段结果压紧后取前 k 个
+    size_t total = 0;
+    for (size_t shard = 0; shard < shards; ++shard)
+    {
+        std::copy(buffer + shard * k, buffer + shard * k + found[shard], buffer + total);
+        total += found[shard];
+    }
+    size_t count = std::min(k, total);
+    std::partial_sort(buffer, buffer + count, buffer + total,
+                      [](const GalleryMatch &a, const GalleryMatch &b)
+                      { return a.distance < b.distance; });
+    std::copy(buffer, buffer + count, out);
+    return count;
+}
+
+// 扩容副本
+std::shared_ptr<ShardedIndex> ShardedIndex::grown_for(uint64_t key, bool &ok) const
+{
+    return this->grown_for(std::vector<uint64_t>{key}, ok);
+}
+
+std::shared_ptr<ShardedIndex> ShardedIndex::grown_for(const std::vector<uint64_t> &keys, bool &ok) const
+{
+    ok = true;
+    std::vector<size_t> needed(this->shards_.size(), 0);
+    for (uint64_t key : keys)
+    {
+        ++needed[this->shard_of(key)];
+    }
+
+    std::shared_ptr<ShardedIndex> next;
+    for (size_t shard = 0; shard < this->shards_.size(); ++shard)
+    {
+        const index_dense_t &index = *this->shards_[shard];
+        if (needed[shard] == 0 || index.size() + needed[shard] < index.capacity())
+        {
+            continue;
+        }
+
+        // usearch 的 reserve 会重新分配内部存储，不能与检索并发，所以复制该分片后再扩容
+        index_dense_t::copy_result_t copy = index.copy();
+        if (!copy)
+        {
+            LOGE("索引扩容失败: " << copy.error.release());
+            ok = false;
+            return nullptr;
+        }
+        std::shared_ptr<index_dense_t> grown = std::make_shared<index_dense_t>(std::move(copy.index));
+        size_t members = std::max<size_t>({index.capacity() * 2, index.size() + needed[shard] + 1, 64});
+        if (!grown->try_reserve(index_limits_t(members, this->threads_)))
+        {
+            LOGE("索引扩容失败: " << members);
+            ok = false;
+            return nullptr;
+        }
+
+        if (!next)
+        {
+            next = std::make_shared<ShardedIndex>(*this);
+        }
+        next->shards_[shard] = std::move(grown);
+        next->tombstones_[shard] = std::make_shared<std::atomic<size_t>>(this->tombstones_[shard]->load());
+    }
+    return next;
+}
+
+bool ShardedIndex::reserve(size_t members_per_shard)
+{
+    for (auto &shard : this->shards_)
+    {
+        if (!shard->try_reserve(index_limits_t(std::max<size_t>(members_per_shard, 64), this->threads_)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 删除其他分片数留下的快照文件（分片数随人脸库规模和核数变化），只保留 shards 个分片的这一组
+static void remove_stale_shards(const std::string &path, size_t shards)
+{
+    std::filesystem::path snapshot(path);
+    std::filesystem::path directory = snapshot.has_parent_path() ? snapshot.parent_path() : std::filesystem::path(".");
+    std::string prefix = snapshot.filename().string() + ".";
+    std::error_code error;
+    std::vector<std::filesystem::path> stale;
+    if (shards != 1 && std::filesystem::exists(snapshot, error))
+    {
+        stale.push_back(snapshot);
+    }
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        // 分片文件名为 <path>.<i>of<n>
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) != 0)
+        {
+            continue;
+        }
+        std::string suffix = name.substr(prefix.size());
+        size_t of = suffix.find("of");
+        if (of == 0 || of == std::string::npos || of + 2 == suffix.size() ||
+            suffix.find_first_not_of("0123456789", 0) != of ||
+            suffix.find_first_not_of("0123456789", of + 2) != std::string::npos)
+        {
+            continue;
+        }
+        if (std::strtoull(suffix.c_str() + of + 2, nullptr, 10) != shards)
+        {
+            stale.push_back(entry.path());
+        }
+    }
+    for (const std::filesystem::path &file : stale)
+    {
+        if (std::filesystem::remove(file, error))
+        {
+            LOGI("删除过期的索引快照分片: " << file.string());
+        }
+    }
+}
+
+// 保存：每个分片先写临时文件再改名，最后删除其他分片数留下的旧文件
+bool ShardedIndex::save(const std::string &path) const
+{
+    for (size_t i = 0; i < this->shards_.size(); ++i)
+    {
+        std::string shard_path = ShardedIndex::shard_path(path, i, this->shards_.size());
+        std::string tmp_path = shard_path + ".tmp";
+        serialization_result_t result = this->shards_[i]->save(tmp_path.c_str());
+        if (!result)
+        {
+            LOGE("索引快照保存失败: " << result.error.release());
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        if (std::rename(tmp_path.c_str(), shard_path.c_str()) != 0)
+        {
+            LOGE("索引快照改名失败: " << shard_path);
+            return false;
+        }
+    }
+    remove_stale_shards(path, this->shards_.size());
+    return true;
+}
+
+// 载入全部分片，任一分片缺失或损坏返回 false
+// 载入后索引还要应用快照之后的变更并继续接受注册，usearch 的 view() 映射出的索引只读，所以读入内存
+bool ShardedIndex::load(const std::string &path)
+{
+    for (size_t i = 0; i < this->shards_.size(); ++i)
+    {
+        std::string shard_path = ShardedIndex::shard_path(path, i, this->shards_.size());
+        if (!std::filesystem::exists(shard_path))
+        {
+            return false;
+        }
+        std::shared_ptr<index_dense_t> shard = std::make_shared<index_dense_t>();
+        serialization_result_t result = shard->load(shard_path.c_str());
+        if (!result)
+        {
+            LOGW("索引快照读取失败: " << shard_path << ", " << result.error.release());
+            return false;
+        }
+        // 快照中保留着已删除的节点，载入后统计一次
+        this->tombstones_[i] = std::make_shared<std::atomic<size_t>>(shard->stats().nodes - shard->size());
+        this->shards_[i] = std::move(shard);
+    }
+    return true;
+}
+
+size_t ShardedIndex::size() const
+{
+    size_t total = 0;
+    for (const auto &shard : this->shards_)
+    {
+        total += shard->size();
+    }
+    return total;
+}
+
+size_t ShardedIndex::tombstones() const
+{
+    size_t total = 0;
+    for (const auto &tombstones : this->tombstones_)
+    {
+        total += tombstones->load();
+    }
+    return total;
+}
+
+size_t ShardedIndex::shard_count() const
+{
+    return this->shards_.size();
+}
+
+size_t ShardedIndex::memory_usage() const
+{
+    size_t total = 0;
+    for (const auto &shard : this->shards_)
+    {
+        total += shard->memory_usage();
+    }
+    return total;
+}
+
+size_t ShardedIndex::dimensions() const
+{
+    return this->shards_[0]->dimensions();
+}
+
+metric_kind_t ShardedIndex::metric_kind() const
+{
+    return this->shards_[0]->metric_kind();
+}
+
+scalar_kind_t ShardedIndex::scalar_kind() const
+{
+    return this->shards_[0]->scalar_kind();
+}
+
+size_t ShardedIndex::connectivity() const
+{
+    return this->shards_[0]->connectivity();
+}
+
+void ShardedIndex::change_expansion(size_t expansion_add, size_t expansion_search)
+{
+    for (auto &shard : this->shards_)
+    {
+        shard->change_expansion_add(expansion_add);
+        shard->change_expansion_search(expansion_search);
+    }
+}
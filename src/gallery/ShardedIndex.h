@@ -0,0 +1,84 @@
+#pragma once
+#include "common.h"
+#include "config.h"
+#include "GalleryTypes.h"
+#include "ThreadPool.h"
+#include "usearch/index.hpp"
+#include "usearch/index_plugins.hpp"
+#include "usearch/index_dense.hpp"
+
+using namespace unum::usearch;
+
+// HNSW 索引分片：key 按取模分到 N 个 usearch 索引，每个分片一个工作线程
+// 检索时各分片并行查询 top-k 再合并；单个分片时直接调用，没有额外开销
+// 各分片以 shared_ptr 持有，复制 ShardedIndex 只复制指针，扩容时只替换需要扩容的那个分片
+class ShardedIndex
+{
+public:
+    // config 为各分片的 HNSW 参数
+    // threads 为同时检索/写入同一分片的外部线程数上限，分片工作线程另外计入
+    ShardedIndex(const metric_punned_t &metric, const index_dense_config_t &config, size_t shards, size_t threads);
+
+    // 根据条目数和 CPU 核数决定分片数，configured 为 GALLERY_SHARDS
+    static size_t auto_shard_count(size_t entries, size_t configured = GALLERY_SHARDS);
+
+    // 分片快照的文件路径，单分片时就是 path 本身（兼容分片之前的快照）
+    static std::string shard_path(const std::string &path, size_t shard, size_t shards);
+
+    // 并行构建：条目分批交给 pool 的全部线程并发写入各分片（usearch 支持并发 add），返回成功添加的条数
+    // 每完成 10% 输出一次进度；pool 的线程数不能超过构造时的 threads
+    // cancel 不为空且被置为 true 时尽快停止，返回已添加的条数
+    // 也可向正在检索的索引追加一批条目，调用方需先用 grown_for 预留容量
+    size_t build(const std::vector<std::pair<uint64_t, const float *>> &entries, ThreadPool &pool,
+                 const std::atomic<bool> *cancel = nullptr);
+
+    bool add(uint64_t key, const float *vector);
+    bool remove(uint64_t key);
+    bool contains(uint64_t key) const;
+
+    // 读出 key 对应的向量（解量化为 f32），不存在返回 false
+    bool get(uint64_t key, float *vector) const;
+
+    // 检索 top-k 写入 out，按距离升序，返回结果数
+    size_t search(const float *query, size_t k, GalleryMatch *out) const;
+
+    // 为 key 所在的分片预留一个位置：容量不足时返回扩容后的副本（原索引不变，可继续被并发检索），否则返回 nullptr
+    // 失败时 ok 置为 false
+    std::shared_ptr<ShardedIndex> grown_for(uint64_t key, bool &ok) const;
+
+    // 同上，为一批 key 预留位置，每个需要扩容的分片只复制一次
+    std::shared_ptr<ShardedIndex> grown_for(const std::vector<uint64_t> &keys, bool &ok) const;
+
+    // 每个分片预留 members_per_shard 个位置
+    bool reserve(size_t members_per_shard);
+
+    // 保存/载入全部分片，path 见 shard_path()；保存时删除其他分片数留下的快照文件
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+    size_t size() const;
+    size_t shard_count() const;
+
+    // 已删除但仍留在 HNSW 图中的节点数（usearch 删除只打标记，检索仍会经过这些节点，新增条目会复用它们）
+    size_t tombstones() const;
+    size_t memory_usage() const;
+
+    // 分片中的索引参数（各分片相同）
+    size_t dimensions() const;
+    metric_kind_t metric_kind() const;
+    scalar_kind_t scalar_kind() const;
+    size_t connectivity() const;
+
+    // 修改各分片的 expansion 参数（快照不保存这两个参数，载入后需重新设置）
+    // expansion_search 可在检索进行中修改，usearch 每次检索时读取该值
+    void change_expansion(size_t expansion_add, size_t expansion_search);
+
+private:
+    size_t shard_of(uint64_t key) const;
+
+    metric_punned_t metric_;
+    size_t threads_;
+    std::vector<std::shared_ptr<index_dense_t>> shards_;
+    std::vector<std::shared_ptr<std::atomic<size_t>>> tombstones_; // 各分片的已删除节点数，与分片一起共用
+    std::shared_ptr<ThreadPool> pool_; // 分片工作线程，各副本共用
+};
@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    // 调用线程作为 0 号线程参与执行，这里只创建 threads - 1 个工作线程
+    for (size_t i = 1; i < threads; ++i)
+    {
+        this->workers_.emplace_back(&ThreadPool::worker, this, i);
+    }
+}
+
+size_t ThreadPool::size() const
+{
+    return this->workers_.size() + 1;
+}
+
+// 领取任务
+void ThreadPool::run_tasks(size_t thread_idx)
+{
+    size_t task;
+    while ((task = this->next_task_.fetch_add(1)) < this->tasks_)
+    {
+        (*this->func_)(thread_idx, task);
+    }
+}
+
+// 工作线程主循环
+void ThreadPool::worker(size_t thread_idx)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            this->start_cv_.wait(lock, [&]
+                                 { return this->stop_ || this->generation_ != seen; });
+            if (this->stop_)
+            {
+                return;
+            }
+            seen = this->generation_;
+        }
+
+        this->run_tasks(thread_idx);
+
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (--this->active_ == 0)
+        {
+            this->done_cv_.notify_one();
+        }
+    }
+}
+
+// 并行执行
+void ThreadPool::parallel_for(size_t tasks, const std::function<void(size_t, size_t)> &func)
+{
+    if (tasks == 0)
+    {
+        return;
+    }
+    // 任务太少或没有工作线程时直接在当前线程执行
+    if (tasks == 1 || this->workers_.empty())
+    {
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            func(0, i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(this->callMutex_);
+    this->dispatch(tasks, func);
+}
+
+// 线程池空闲时并行执行
+bool ThreadPool::try_parallel_for(size_t tasks, const std::function<void(size_t, size_t)> &func)
+{
+    if (tasks <= 1 || this->workers_.empty())
+    {
+        this->parallel_for(tasks, func);
+        return true;
+    }
+
+    std::unique_lock<std::mutex> call_lock(this->callMutex_, std::try_to_lock);
+    if (!call_lock.owns_lock())
+    {
+        return false;
+    }
+    this->dispatch(tasks, func);
+    return true;
+}
+
+void ThreadPool::dispatch(size_t tasks, const std::function<void(size_t, size_t)> &func)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->func_ = &func;
+        this->tasks_ = tasks;
+        this->next_task_ = 0;
+        this->active_ = this->workers_.size();
+        ++this->generation_;
+    }
+    this->start_cv_.notify_all();
+
+    this->run_tasks(0);
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    this->done_cv_.wait(lock, [&]
+                        { return this->active_ == 0; });
+    this->func_ = nullptr;
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->stop_ = true;
+    }
+    this->start_cv_.notify_all();
+    for (std::thread &t : this->workers_)
+    {
+        t.join();
+    }
+}
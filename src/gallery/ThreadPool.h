@@ -0,0 +1,49 @@
+#pragma once
+#include "common.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+// 常驻线程池，用于批量检索、并行建索引等场景
+class ThreadPool
+{
+public:
+    // threads 为 0 时使用 CPU 核数
+    explicit ThreadPool(size_t threads = 0);
+
+    // 并行执行 tasks 个任务，func(thread_idx, task_idx)，调用线程也参与执行，全部完成后返回
+    void parallel_for(size_t tasks, const std::function<void(size_t, size_t)> &func);
+
+    // 同上，但线程池正被其他调用占用时不等待，直接返回 false，由调用方自行执行
+    bool try_parallel_for(size_t tasks, const std::function<void(size_t, size_t)> &func);
+
+    // 线程数（含调用线程）
+    size_t size() const;
+
+    ~ThreadPool();
+
+private:
+    // 工作线程主循环
+    void worker(size_t thread_idx);
+
+    // 领取并执行任务，直到没有剩余任务
+    void run_tasks(size_t thread_idx);
+
+    // 分发一批任务并等待完成，调用方已持有 callMutex_
+    void dispatch(size_t tasks, const std::function<void(size_t, size_t)> &func);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex callMutex_; // 同一时间只允许一个 parallel_for
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+
+    const std::function<void(size_t, size_t)> *func_ = nullptr;
+    size_t tasks_ = 0;
+    std::atomic<size_t> next_task_{0};
+    size_t active_ = 0;      // 仍在执行当前批次的工作线程数
+    uint64_t generation_ = 0; // 批次编号，用于唤醒工作线程
+    bool stop_ = false;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+// 索引量化方式: "f32" 不量化; "f16" 半精度, 索引内存减半; "i8" 8位整数, 索引内存约 1/4 (仅用于余弦度量)
+#define GALLERY_QUANTIZATION "f32"
+
+// HNSW 图参数的默认值, 运行时可通过 FaceGallery::set_index_params() 调整, bench_index_params 用于选取
+// 每个节点的邻居数 (M): 越大召回越高, 索引内存和建索引耗时也越大; 修改后需重建索引
+#define GALLERY_CONNECTIVITY 16
+// 建索引时的候选队列长度 (efConstruction): 越大图质量越好, 建索引越慢; 修改后需重建索引
+#define GALLERY_EXPANSION_ADD 128
+// 检索时的候选队列长度 (ef): 越大召回越高, 检索越慢; 立即生效
+#define GALLERY_EXPANSION_SEARCH 64
+
+// 量化索引先取 k * GALLERY_RERANK_FACTOR 个候选, 再用 f32 特征精排
+#define GALLERY_RERANK_FACTOR 4
+
+// 量化模式下启动时抽样评估召回率的查询数, 0 表示不评估
+#define GALLERY_RECALL_SAMPLES 100
+
+// 人脸数不超过此值时使用 SIMD 暴力检索（精确），超过后切换到 HNSW 索引
+// 人脸数回落到一半以下时再切回暴力检索，避免在阈值附近来回切换
+#define GALLERY_FLAT_MAX_SIZE 5000
+
+// 批量检索（一帧多张人脸）的线程数, 0 表示 CPU 核数
+#define GALLERY_SEARCH_THREADS 0
+
+// 身份聚合方式: "max" 取该身份命中模板中的最小距离; "mean" 取命中模板距离的平均值
+#define GALLERY_IDENTITY_SCORING "max"
+
+// 按身份检索时先取 k * GALLERY_TEMPLATE_FANOUT 个模板, 再按身份合并
+#define GALLERY_TEMPLATE_FANOUT 8
+
+// 为 true 时索引中每个身份只存一个质心（模板均值），索引规模按人数而非照片数增长
+#define GALLERY_IDENTITY_CENTROID false
+
+// 重建索引时每批交给一个线程的条目数, 全部批次由批量检索线程池并发写入
+#define GALLERY_BUILD_BATCH 1024
+
+// 人脸库版本中人脸表、身份表的最少桶数, 注册/删除只复制被修改的桶; 载入时按规模增加到约 sqrt(人脸数)
+#define GALLERY_STATE_BUCKETS 1024
+
+// 同时检索人脸库的线程数上限（识别线程 + 批量检索线程池），超过时新的读者等待空闲槽位
+#define GALLERY_MAX_READER_THREADS 64
+
+// HNSW 索引分片数, 每个分片一个工作线程, 检索时并行查询各分片再合并 top-k
+// 0 表示自动: 每 GALLERY_SHARD_MIN_SIZE 个条目一个分片, 不超过 CPU 核数 (千万级人脸库在多核机器上自动分片)
+#define GALLERY_SHARDS 0
+
+// 自动分片时每个分片的最小条目数, 规模较小时分片的合并开销大于收益
+#define GALLERY_SHARD_MIN_SIZE 1000000
+
+// 检查数据库是否被其他进程修改 (PRAGMA data_version) 的间隔, 有修改时把变更同步到索引; 0 表示不监视
+#define GALLERY_WATCH_INTERVAL_MS 1000
+
+// HNSW 中已删除节点占比超过此值时在后台重建索引 (压缩), 0 表示不自动压缩
+#define GALLERY_COMPACT_RATIO 0.2
+
+// 已删除节点少于此数时不压缩, 小库删除几张人脸不值得重建
+#define GALLERY_COMPACT_MIN_TOMBSTONES 1000
+
+// 后台压缩使用的线程数, 压缩期间识别照常进行, 不宜占满 CPU
+#define GALLERY_COMPACT_THREADS 1
+
+// 为 true 时大库 (超过 GALLERY_FLAT_MAX_SIZE) 改用符号位签名线性扫描代替 HNSW 检索 (不支持质心模式):
+// 每维 1 bit, popcount 计算汉明距离取 k * GALLERY_BINARY_CANDIDATES 个候选, 再用 f32 特征精排; 对比见 bench_binary_prefilter
+#define GALLERY_BINARY_PREFILTER false
+
+// 签名扫描为每个结果保留的候选数, 越大召回越高, 精排越慢
+#define GALLERY_BINARY_CANDIDATES 32
+
+// 签名索引每块的行数和块数上限 (上限 GALLERY_BINARY_BLOCK_ROWS * GALLERY_BINARY_MAX_BLOCKS 行)
+#define GALLERY_BINARY_BLOCK_ROWS 65536
+#define GALLERY_BINARY_MAX_BLOCKS 4096
+
+// 重复身份检测 (tools/find_duplicates) 时每张人脸检查的近邻数, 越大越不容易漏掉重复, 检索越慢
+#define GALLERY_DEDUP_NEIGHBORS 10
@@ -89,6 +89,18 @@ std::vector<Facedata> InspireFaceCoder::get_facedatas(const cv::Mat &image)
     return facedatas;
 }
 
+// 当前模型输出的特征向量维度（Pikachu / Megatron 等模型包不同）
+int InspireFaceCoder::feature_length()
+{
+    int32_t length = 0;
+    if (HFGetFeatureLength(&length) != HSUCCEED)
+    {
+        LOGE("获取特征维度失败");
+        return 0;
+    }
+    return length;
+}
+
 // 两个人脸对比，返回余弦相似度
 float InspireFaceCoder::compareFeatures(const Facedata &face1, const Facedata &face2)
 {
@@ -1,6 +1,7 @@
 #pragma once
 #include "config.h"
 #include <inspireface/inspireface.hpp>
+#include <inspireface.h>
 
 
 class InspireFaceCoder
@@ -17,6 +18,9 @@ public:
     // 人脸特征提取, 一个图片可能有多个人脸,返回Facedata数组
     std::vector<Facedata> get_facedatas(const cv::Mat& image);
 
+    // 当前模型输出的特征向量维度，获取失败返回 0
+    int feature_length();
+
     // 两个人脸对比，返回余弦相似度
     float compareFeatures(const Facedata& face1, const Facedata& face2);
 
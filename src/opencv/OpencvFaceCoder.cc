@@ -124,6 +124,15 @@ std::vector<Facedata> OpencvFaceCoder::get_facedatas(const cv::Mat& image)
     return facedatas;
 }
 
+// 当前模型输出的特征向量维度，用一张空白的对齐人脸跑一次特征提取得到
+int OpencvFaceCoder::feature_length()
+{
+    cv::Mat blank = cv::Mat::zeros(RECOGNIZER_INPUT_SIZE, RECOGNIZER_INPUT_SIZE, CV_8UC3);
+    cv::Mat feature;
+    this->recognizer_->feature(blank, feature);
+    return static_cast<int>(feature.total());
+}
+
 // 两个人脸特征进行比较计算, 返回相似度分数
 double OpencvFaceCoder::compareFeatures(const Facedata& face1, const Facedata& face2)
 {
@@ -24,6 +24,9 @@ public:
     // 人脸特征提取, 一个图片可能有多个人脸,返回Facedata数组
     std::vector<Facedata> get_facedatas(const cv::Mat& image);
 
+    // 当前模型输出的特征向量维度
+    int feature_length();
+
     // 两个人脸特征进行比较, 返回相似度分数
     double compareFeatures(const Facedata& face1, const Facedata& face2);
 
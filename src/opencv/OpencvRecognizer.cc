@@ -6,41 +6,22 @@ OpencvRecognizer::OpencvRecognizer(const std::string &dbPath,
                                    const std::string &recognizerPath)
 {
     this->facedatabase_ = FaceDatabase::create(dbPath, OPENCV);
+    // 重放上次退出前未写入数据库的注册，须在加载人脸库之前
+    this->journal_ = FaceJournal::create(this->facedatabase_.get(), dbPath + ".opencv" DATABASE_JOURNAL_SUFFIX);
     this->facecoder_ = OpencvFaceCoder::create(detectorPath, recognizerPath);
 
-    // 加载人脸数据库中的所有人脸数据到内存
-    std::vector<Facedata> facedatas = facedatabase_->load_all_faces();
-
-    // 1. 定义度量
-    metric_punned_t metric(128, metric_kind_t::cos_k, scalar_kind_t::f32_k);
-
-    // 2. 定义配置 (可选，但建议显式指定)
-    index_dense_config_t config;
-    // config.connectivity = 16; // 默认 M=16，增加此值可提高精度但增加内存
-
-    // 3. 初始化索引
-    this->index_ = index_dense_t::make(metric, config);
-
-    // 4. 预留空间（提升性能）
-    this->index_.reserve(facedatas.size());
-
-    // 5. 循环添加数据
-    for (const Facedata &face : facedatas)
-    {
-        // 1. 加入向量索引
-        // 注意：这里的 face.id 必须是正整数 (uint64_t)
-        this->index_.add(face.id, face.embedding.data());
-
-        //  额外存一个 ID 到数据的映射，方便搜索后直接取出结构体
-        this->facedata_map_[face.id] = face;
-    }
+    // 加载人脸库，特征维度由当前模型决定，索引快照有效时直接载入，否则从数据库重建
+    this->gallery_ = FaceGallery::create(this->facedatabase_.get(),
+                                         dbPath + ".opencv" GALLERY_SNAPSHOT_SUFFIX,
+                                         this->facecoder_->feature_length(),
+                                         metric_kind_t::cos_k);
+    this->gallery_->set_journal(this->journal_.get());
 }
 
 // 在人脸库中注册新的人脸（传入图片路径）
 bool OpencvRecognizer::registerFace(const std::string path, const std::string &name)
 {
     cv::Mat image = cv::imread(path);
-    std::string registered_name = name;
     // 判空
     if (image.empty())
     {
@@ -49,25 +30,17 @@ bool OpencvRecognizer::registerFace(const std::string path, const std::string &n
     }
 
     // 检测人脸库里面是否有这个人脸，这里做特征向量匹配
+    // 同名的人脸作为该身份的一张新模板注册，只拒绝已属于其他人的人脸
     std::vector<Facedata> list = this->recognizeFace(image);
     for (const auto &face : list)
     {
-        if (face.name != "unknown")
+        if (face.name != "unknown" && face.name != name)
         {
             LOGE("已存在此人脸，请勿重复注册，名字:" << face.name);
             return false;
         }
     }
 
-    // 检查是否已有相同名称的人脸，若有则添加编号后缀
-    auto existing_faces = this->facedatabase_->find_by_name(name);
-    int count = existing_faces.size();
-    if (count > 0)
-    {
-        registered_name += std::to_string(count);
-        LOGW("名称:" << name << "已存在，注册为新名称: " << registered_name);
-    }
-
     // 提取人脸特征
     std::vector<Facedata> newFaces = facecoder_->get_facedatas(image);
     if (newFaces.empty())
@@ -83,34 +56,31 @@ bool OpencvRecognizer::registerFace(const std::string path, const std::string &n
 
     // 只注册第一张检测到的人脸
     Facedata &newFace = newFaces[0];
-    newFace.name = registered_name;
+    newFace.name = name; // 同名即同一身份
 
-    // 插入到数据库
-    uint64_t id = facedatabase_->insert(newFace, path); // img_path 可选，这里传空字符串
-    if (-1 != id)
+    // 先分配 id 和身份加入内存人脸库，立即可检索；数据库写入由写后日志在后台完成
+    if (!this->journal_->reserve(newFace))
     {
-        // 同时添加到内存中的人脸数据
-        this->facedata_map_[id] = newFace;
-        this->index_.add(id, newFace.embedding.data());
+        LOGW("insert face failed");
+        return false;
     }
-    else
+    if (!this->gallery_->add(newFace))
     {
-        LOGW("insert face failed");
+        this->journal_->release(newFace.id);
         return false;
     }
-    return true;
+    return this->journal_->append(newFace, path);
 }
 
 // 在人脸库中注册新的人脸（传入opencv 图片）
 bool OpencvRecognizer::registerFace(const cv::Mat &image, const std::string &name)
 {
-    std::string registered_name = name;
-
     // 检测人脸库里面是否有这个人脸，这里做特征向量匹配
+    // 同名的人脸作为该身份的一张新模板注册，只拒绝已属于其他人的人脸
     std::vector<Facedata> list = this->recognizeFace(image);
     for (const auto &face : list)
     {
-        if (face.name != "unknown")
+        if (face.name != "unknown" && face.name != name)
         {
             LOGE("已存在此人脸，请勿重复注册，名字:" << face.name);
             return false;
@@ -130,128 +100,121 @@ bool OpencvRecognizer::registerFace(const cv::Mat &image, const std::string &nam
         return false;
     }
 
-    // 检查是否已有相同名称的人脸，若有则添加编号后缀
-    auto existing_faces = this->facedatabase_->find_by_name(name);
-    int count = existing_faces.size();
-    if (count > 0)
-    {
-        registered_name += std::to_string(count);
-        LOGW("名称:" << name << "已存在，注册为新名称: " << registered_name);
-    }
-
     // 开始注册操作
     Facedata &newFace = newFaces[0];
-    newFace.name = registered_name;
+    newFace.name = name; // 同名即同一身份
 
-    // 插入到数据库
-    uint64_t id = this->facedatabase_->insert(newFace, ""); // img_path 可选，这里传空字符串
-    if (-1 != id)
+    // 先分配 id 和身份加入内存人脸库，立即可检索；数据库写入由写后日志在后台完成
+    if (!this->journal_->reserve(newFace))
     {
-        // 同时添加到内存中的人脸数据
-        this->facedata_map_[id] = newFace;
-        this->index_.add(id, newFace.embedding.data());
+        LOGW("insert face failed");
+        return false;
     }
-    else
+    if (!this->gallery_->add(newFace))
     {
-        LOGE("插入失败");
+        this->journal_->release(newFace.id);
         return false;
     }
-    return true;
+    return this->journal_->append(newFace, "");
+}
+
+// 批量注册：编码器不支持并发推理，推理串行执行，与其他线程的读图解码重叠
+std::vector<int64_t> OpencvRecognizer::registerFaces(const std::vector<FaceEnrollment> &batch)
+{
+    std::mutex coderMutex;
+    return this->gallery_->enroll_batch(
+        batch,
+        [&](const std::string &path)
+        {
+            cv::Mat image = cv::imread(path);
+            if (image.empty())
+            {
+                LOGE("无法读取图像文件: " << path);
+                return std::vector<Facedata>();
+            }
+            std::lock_guard<std::mutex> lock(coderMutex);
+            return this->facecoder_->get_facedatas(image);
+        },
+        // 余弦距离 = 1 - 余弦相似度
+        [this](float distance)
+        { return 1.0f - distance >= this->threshold_; });
 }
 
 // 在人脸库匹配图片的人脸特征，返回对应的人脸结构列表
 std::vector<Facedata> OpencvRecognizer::recognizeFace(const cv::Mat &faceImage)
 {
-    std::vector<Facedata> queryFaces = this->facecoder_->get_facedatas(faceImage);
-
-    if (queryFaces.empty())
+    // 只取最佳候选
+    std::vector<FaceRecognition> results = this->recognizeTopK(faceImage, 1);
+    std::vector<Facedata> faces;
+    faces.reserve(results.size());
+    for (FaceRecognition &result : results)
     {
-        // LOGE("未检测到人脸，识别失败");
-        return queryFaces;
+        faces.push_back(std::move(result.face));
     }
+    return faces;
+}
 
-    // 当前人脸查找方式（使用向量索引查找）
-    for (auto &queryFace : queryFaces)
+// 在人脸库查找每张人脸最相近的 k 个身份，一次批量检索得到全部候选
+std::vector<FaceRecognition> OpencvRecognizer::recognizeTopK(const cv::Mat &faceImage, size_t k)
+{
+    std::vector<Facedata> queryFaces = this->facecoder_->get_facedatas(faceImage);
+    std::vector<FaceRecognition> results(queryFaces.size());
+    for (size_t f = 0; f < queryFaces.size(); ++f)
     {
-        if (this->index_.size() <= 0)
-        {
-            return queryFaces;
-        }
-        auto results = this->index_.search(queryFace.embedding.data(), 3);
-
-        for (size_t i = 0; i < results.size(); ++i)
-        {
-            uint64_t found_id = results[i].member.key; // 之前 add 进去的 ID
-            float distance = results[i].distance;      // 余弦距离  注意：余弦距离(Distance) = 1 - 余弦相似度(Similarity)，距离越小（接近0），代表越相似
-
-            Facedata match = this->facedata_map_[found_id];                          //  获取之前 add 进去的 Facedata
-            double similarity = this->facecoder_->compareFeatures(queryFace, match); //  计算余弦相似度
-            if (similarity >= this->threshold_)
-            {
-                queryFace.id = match.id;
-                queryFace.name = match.name;
-                queryFace.score = distance;
-            }
-        }
+        results[f].face = std::move(queryFaces[f]);
     }
 
-    // 原本的查找方式(一个个遍历计算余弦相似度)
-
-    // for (auto &queryFace : queryFaces)
-    // {
-    //     double bestScore = 0.0;
-    //     Facedata bestMatch;
-    //     for (const auto &[_, dbFace] : this->facedata_map_)
-    //     {
-    //         double score = facecoder_->compareFeatures(queryFace, dbFace);
-    //         if (score > bestScore)
-    //         {
-    //             bestScore = score;
-    //             bestMatch = dbFace;
-    //         }
-    //         // 如果相似度超过阈值，认为是同一人
-    //         if (bestScore >= this->threshold_)
-    //         {
-    //             // 更新查询人脸的信息为匹配到的数据库人脸
-    //             queryFace.id = bestMatch.id;
-    //             queryFace.name = bestMatch.name;
-    //             queryFace.score = bestScore;
-    //             break;
-    //         }
-    //     }
-    // }
-
-    return queryFaces;
+    // 余弦距离(Distance) = 1 - 余弦相似度(Similarity)
+    this->gallery_->recognize(results, k, [this](float distance)
+                              {
+                                  float similarity = 1.0f - distance;
+                                  return GalleryScore{similarity, distance, similarity >= this->threshold_}; });
+    return results;
 }
 
 // 通过name查找人脸
 std::vector<Facedata> OpencvRecognizer::findByNname(const std::string &name)
 {
+    // 等待排队的注册写入数据库，读到刚注册的人脸
+    if (!this->journal_->flush())
+    {
+        LOGE("有注册尚未写入数据库，无法按姓名查找: " << name);
+        return {};
+    }
     return this->facedatabase_->find_by_name(name);
 }
 
 // 删除人脸操作
 bool OpencvRecognizer::deleteFaceByName(const std::string &name)
 {
-    // 从数据库删除
-    uint64_t id = facedatabase_->delete_by_name(name);
-    if (-1 != id)
+    // 排队的注册先写入数据库，否则删除之后又会被写回
+    if (!this->journal_->flush())
     {
-        // 同时从内存中删除
-        this->facedata_map_.erase(id);
-        this->index_.remove(id);
+        LOGE("有注册尚未写入数据库，暂不能删除: " << name);
+        return false;
     }
-    else
+
+    // 从数据库删除该姓名的全部人脸
+    std::vector<int64_t> ids = facedatabase_->delete_by_name(name);
+    if (ids.empty())
     {
         LOGE("删除人脸失败: {}" << name);
         return false;
     }
+
+    // 同时从内存中删除，整批发布一个版本
+    this->gallery_->remove(std::vector<uint64_t>(ids.begin(), ids.end()));
     return true;
 }
 
 // 查看人脸数据库中人脸数量
 int OpencvRecognizer::getFacedatabaseCount()
 {
+    if (!this->journal_->flush())
+    {
+        LOGE("有注册尚未写入数据库，无法统计人脸数量");
+        return -1;
+    }
     return facedatabase_->get_face_count();
 }
 
@@ -270,6 +233,16 @@ bool OpencvRecognizer::setThreshold(double threshold)
     return threshold == this->threshold_;
 }
 
+// 设置人脸库 HNSW 索引参数
+bool OpencvRecognizer::setIndexParams(size_t connectivity, size_t expansion_add, size_t expansion_search)
+{
+    GalleryIndexParams params;
+    params.connectivity = connectivity;
+    params.expansion_add = expansion_add;
+    params.expansion_search = expansion_search;
+    return this->gallery_->set_index_params(params);
+}
+
 // 获取当前使用的后端名称
 std::string OpencvRecognizer::getBackendName() const
 {
@@ -1,5 +1,7 @@
 #pragma once
 #include "database/FaceDatabase.h"
+#include "database/FaceJournal.h"
+#include "gallery/FaceGallery.h"
 #include "OpencvFaceCoder.h"
 #include <unordered_map>
 
@@ -14,8 +16,14 @@ public:
     bool registerFace(const cv::Mat &image, const std::string &name) override;
     bool registerFace(const std::string path, const std::string &name) override;
 
+    // 批量注册
+    std::vector<int64_t> registerFaces(const std::vector<FaceEnrollment> &batch) override;
+
     // 在人脸库查找此人脸特征，返回对应人脸结构体
     std::vector<Facedata> recognizeFace(const cv::Mat &faceImage) override;
+
+    // 在人脸库查找每张人脸最相近的 k 个身份
+    std::vector<FaceRecognition> recognizeTopK(const cv::Mat &faceImage, size_t k) override;
     // 通过name查找人脸库
     std::vector<Facedata> findByNname(const std::string &name) override;
 
@@ -31,6 +39,9 @@ public:
     // 设置阈值（用于判断是否为同一人）
     bool setThreshold(double threshold) override;
 
+    // 设置人脸库 HNSW 索引参数
+    bool setIndexParams(size_t connectivity, size_t expansion_add, size_t expansion_search) override;
+
     // 获取当前使用的后端名称（用于日志/调试）
     std::string getBackendName() const override;
 
@@ -38,12 +49,11 @@ public:
 
 private:
     std::unique_ptr<FaceDatabase> facedatabase_; // 人脸数据库实例
+    std::unique_ptr<FaceJournal> journal_;   // 注册写后日志，须在数据库之前析构
     std::unique_ptr<OpencvFaceCoder> facecoder_; // 人脸编码器实例
 
-    // 人脸数据全部加载到内存
-    std::unordered_map<uint64_t, Facedata> facedata_map_;
-
-    index_dense_t index_;
+    // 内存中的人脸库（向量索引 + 人脸数据）
+    std::unique_ptr<FaceGallery> gallery_;
 
     double threshold_ = RECOGNIZER_CONFIDENCE_THRESHOLD; // 相似度阈值
 };
@@ -0,0 +1,65 @@
+#include "database/FaceDatabase.h"
+#include "gallery/DuplicateFinder.h"
+#include <cmath>
+#include <cstdio>
+
+// 离线重复身份检测：对人脸库做近似全对相似度连接，把相似度超过阈值的不同身份合并成簇输出，
+// 用于发现同一人以不同姓名 / 身份重复注册的情况
+// 用法: find_duplicates face.db [后端 inspireface|opencv|dlib] [阈值] [近邻数] [线程数]
+// 阈值：inspireface / opencv 为余弦相似度 (默认 0.6)，dlib 为欧氏距离 (默认 0.4)
+
+static Type parse_backend(const std::string &name)
+{
+    if (name == "dlib")
+    {
+        return DLIB;
+    }
+    if (name == "opencv")
+    {
+        return OPENCV;
+    }
+    return INSPIREFACE;
+}
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2)
+    {
+        std::printf("usage: %s face.db [inspireface|opencv|dlib] [threshold] [neighbors] [threads]\n", argv[0]);
+        return 1;
+    }
+    std::string path = argv[1];
+    std::string backend = argc > 2 ? argv[2] : "inspireface";
+    bool dlib = backend == "dlib";
+    float threshold = argc > 3 ? std::stof(argv[3]) : (dlib ? 0.4f : 0.6f);
+    size_t neighbors = argc > 4 ? std::stoul(argv[4]) : GALLERY_DEDUP_NEIGHBORS;
+    size_t threads = argc > 5 ? std::stoul(argv[5]) : 0;
+
+    std::unique_ptr<FaceDatabase> db = FaceDatabase::create(path, parse_backend(backend));
+    if (!db)
+    {
+        return 1;
+    }
+    std::vector<Facedata> faces = db->load_all_faces();
+
+    // 与识别端一致：dlib 用 l2sq（阈值取平方），其余后端用余弦距离 1 - 相似度
+    metric_kind_t metric = dlib ? metric_kind_t::l2sq_k : metric_kind_t::cos_k;
+    float max_distance = dlib ? threshold * threshold : 1.f - threshold;
+
+    DuplicateFinder finder(metric, neighbors, threads);
+    std::vector<DuplicateCluster> clusters = finder.find(faces, max_distance);
+
+    std::printf("%zu faces, %zu clusters of likely duplicate identities\n", faces.size(), clusters.size());
+    for (const DuplicateCluster &cluster : clusters)
+    {
+        float score = dlib ? std::sqrt(cluster.distance) : 1.f - cluster.distance;
+        std::printf("%s %.4f (faces %d, %d; %zu pairs):", dlib ? "distance" : "similarity", score,
+                    cluster.face_a, cluster.face_b, cluster.pairs);
+        for (size_t i = 0; i < cluster.identity_ids.size(); ++i)
+        {
+            std::printf(" %d:%s", cluster.identity_ids[i], cluster.names[i].c_str());
+        }
+        std::printf("\n");
+    }
+    return 0;
+}